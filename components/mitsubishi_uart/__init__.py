@@ -1,5 +1,6 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome import automation
 from esphome.components import climate, uart, sensor, binary_sensor, text_sensor, select, switch
 from esphome.core import CORE
 from esphome.const import (
@@ -14,8 +15,10 @@ from esphome.const import (
     ENTITY_CATEGORY_CONFIG,
     ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
     UNIT_CELSIUS,
     UNIT_HERTZ,
+    UNIT_MILLISECOND,
 )
 from esphome.core import coroutine
 
@@ -29,6 +32,10 @@ CONF_SENSORS = "sensors"
 CONF_SENSORS_THERMOSTAT_TEMP = "thermostat_temperature"
 CONF_SENSORS_ERROR_CODE = "error_code"
 
+CONF_DIAGNOSTIC_SENSORS = "diagnostic_sensors"
+CONF_DIAGNOSTIC_INTERVAL = "diagnostic_interval"
+CONF_ROUND_TRIP = "round_trip"
+
 CONF_SELECTS = "selects"
 CONF_TEMPERATURE_SOURCE_SELECT = "temperature_source_select" # This is to create a Select object for selecting a source
 CONF_VANE_POSITION_SELECT = "vane_position_select"
@@ -38,6 +45,13 @@ CONF_TEMPERATURE_SOURCES = "temperature_sources" # This is for specifying additi
 
 CONF_ACTIVE_MODE_SWITCH = "active_mode_switch"
 
+CONF_POLLING_INTERVALS = "polling_intervals"
+
+CONF_THERMOSTAT_CUT_THROUGH = "thermostat_cut_through"
+CONF_THERMOSTAT_CACHE_MAX_AGE = "thermostat_cache_max_age"
+
+CONF_PUBLISH_DEBOUNCE = "publish_debounce"
+
 DEFAULT_POLLING_INTERVAL = "5s"
 
 mitsubishi_uart_ns = cg.esphome_ns.namespace("mitsubishi_uart")
@@ -49,6 +63,14 @@ HorizontalVanePositionSelect = mitsubishi_uart_ns.class_("HorizontalVanePosition
 
 ActiveModeSwitch = mitsubishi_uart_ns.class_("ActiveModeSwitch", switch.Switch, cg.Component)
 
+DumpFlightRecorderAction = mitsubishi_uart_ns.class_("DumpFlightRecorderAction", automation.Action)
+
+GetCommand = mitsubishi_uart_ns.enum("GetCommand", is_class=True)
+BridgeStat = mitsubishi_uart_ns.enum("BridgeStat", is_class=True)
+SourceBridge = mitsubishi_uart_ns.enum("SourceBridge", is_class=True)
+RoundTripCommand = mitsubishi_uart_ns.enum("RoundTripCommand", is_class=True)
+RoundTripStatistic = mitsubishi_uart_ns.enum("RoundTripStatistic", is_class=True)
+
 DEFAULT_CLIMATE_MODES = ["OFF", "HEAT", "DRY", "COOL", "FAN_ONLY", "HEAT_COOL"]
 DEFAULT_FAN_MODES = ["AUTO", "QUIET", "LOW", "MEDIUM", "HIGH"]
 CUSTOM_FAN_MODES = {
@@ -61,16 +83,35 @@ INTERNAL_TEMPERATURE_SOURCE_OPTIONS = [mitsubishi_uart_ns.TEMPERATURE_SOURCE_INT
 
 validate_custom_fan_modes = cv.enum(CUSTOM_FAN_MODES, upper=True)
 
+# How often each get request is sent to the heat pump (the update interval is the finest granularity)
+POLLING_INTERVALS = {
+    "settings": (GetCommand.settings, "10s"),
+    "standby": (GetCommand.standby, "30s"),
+    "status": (GetCommand.status, "30s"),
+    "current_temperature": (GetCommand.current_temp, "30s"),
+    "error_info": (GetCommand.error_info, "300s"),
+}
+
+POLLING_INTERVALS_SCHEMA = cv.Schema({
+    cv.Optional(poll_designator, default=poll_default): cv.positive_time_period_milliseconds
+    for poll_designator, (poll_command, poll_default) in POLLING_INTERVALS.items()
+})
+
 BASE_SCHEMA = cv.polling_component_schema(DEFAULT_POLLING_INTERVAL).extend(climate.CLIMATE_SCHEMA).extend({
     cv.GenerateID(CONF_ID): cv.declare_id(MitsubishiUART),
     cv.Required(CONF_HP_UART): cv.use_id(uart.UARTComponent),
     cv.Optional(CONF_TS_UART): cv.use_id(uart.UARTComponent),
+    cv.Optional(CONF_THERMOSTAT_CUT_THROUGH, default=False): cv.boolean,
+    cv.Optional(CONF_THERMOSTAT_CACHE_MAX_AGE, default="0s"): cv.positive_time_period_milliseconds,
+    # How long to wait after a state change is received before publishing it (so related changes publish together)
+    cv.Optional(CONF_PUBLISH_DEBOUNCE, default="50ms"): cv.positive_time_period_milliseconds,
     cv.Optional(CONF_NAME, default="Climate") : cv.string,
 
     cv.Optional(CONF_SUPPORTED_MODES, default=DEFAULT_CLIMATE_MODES) : cv.ensure_list(climate.validate_climate_mode),
     cv.Optional(CONF_SUPPORTED_FAN_MODES, default=DEFAULT_FAN_MODES): cv.ensure_list(climate.validate_climate_fan_mode),
     cv.Optional(CONF_CUSTOM_FAN_MODES, default=["VERYHIGH"]) : cv.ensure_list(validate_custom_fan_modes),
     cv.Optional(CONF_TEMPERATURE_SOURCES, default=[]) : cv.ensure_list(cv.use_id(sensor.Sensor)),
+    cv.Optional(CONF_POLLING_INTERVALS, default={}) : POLLING_INTERVALS_SCHEMA,
     cv.Optional(CONF_ACTIVE_MODE_SWITCH, default={"name":"Active Mode"}) : switch.switch_schema(
         ActiveModeSwitch,
         entity_category=ENTITY_CATEGORY_CONFIG,
@@ -138,6 +179,85 @@ SENSORS_SCHEMA = cv.All({
     for sensor_designator, (sensor_name, sensor_schema, registration_function) in SENSORS.items()
 })
 
+ROUND_TRIP_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+    state_class=STATE_CLASS_MEASUREMENT,
+    icon="mdi:timer-outline",
+)
+
+# Bridge diagnostics; unlike SENSORS these are only created if configured
+DIAGNOSTIC_SENSORS = {
+    "round_trip_p50": ROUND_TRIP_SENSOR_SCHEMA,
+    "round_trip_p95": ROUND_TRIP_SENSOR_SCHEMA,
+    "round_trip_max": ROUND_TRIP_SENSOR_SCHEMA,
+}
+
+# Round trip times of each type of request, configured as e.g. round_trip: {settings: {p95: ...}}
+ROUND_TRIP_COMMANDS = {
+    "connect": RoundTripCommand.connect,
+    "extended_connect": RoundTripCommand.extended_connect,
+    "settings": RoundTripCommand.get_settings,
+    "current_temperature": RoundTripCommand.get_current_temp,
+    "error_info": RoundTripCommand.get_error_info,
+    "status": RoundTripCommand.get_status,
+    "standby": RoundTripCommand.get_standby,
+    "set_settings": RoundTripCommand.set_settings,
+    "set_remote_temperature": RoundTripCommand.set_remote_temp,
+    "other": RoundTripCommand.other,
+}
+ROUND_TRIP_STATISTICS = {
+    "p50": RoundTripStatistic.p50,
+    "p95": RoundTripStatistic.p95,
+    "max": RoundTripStatistic.max,
+}
+
+ROUND_TRIP_SCHEMA = cv.Schema({
+    cv.Optional(command_designator): cv.Schema({
+        cv.Optional(statistic_designator): ROUND_TRIP_SENSOR_SCHEMA
+        for statistic_designator in ROUND_TRIP_STATISTICS
+    })
+    for command_designator in ROUND_TRIP_COMMANDS
+})
+
+# Per-bridge health counters, created as e.g. heatpump_checksum_failures or thermostat_queue_drops
+BRIDGE_STATS = {
+    "frames_received": ("mdi:download-network", STATE_CLASS_TOTAL_INCREASING),
+    "frames_sent": ("mdi:upload-network", STATE_CLASS_TOTAL_INCREASING),
+    "bytes_discarded": ("mdi:delete-outline", STATE_CLASS_TOTAL_INCREASING),
+    "checksum_failures": ("mdi:alert-circle-outline", STATE_CLASS_TOTAL_INCREASING),
+    "timeouts": ("mdi:timer-alert-outline", STATE_CLASS_TOTAL_INCREASING),
+    "queue_drops": ("mdi:tray-remove", STATE_CLASS_TOTAL_INCREASING),
+    "queue_high_water": ("mdi:tray-full", STATE_CLASS_MEASUREMENT),
+    "receive_limit_hits": ("mdi:speedometer", STATE_CLASS_TOTAL_INCREASING),
+    "receive_max_micros": ("mdi:timer-outline", STATE_CLASS_MEASUREMENT),
+}
+BRIDGES = {
+    "heatpump": SourceBridge.heatpump,
+    "thermostat": SourceBridge.thermostat,
+}
+
+BRIDGE_STAT_SENSORS = {
+    f"{bridge_name}_{stat_name}": (bridge_name, getattr(BridgeStat, stat_name), sensor.sensor_schema(
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        state_class=state_class,
+        accuracy_decimals=0,
+        icon=icon,
+    ))
+    for bridge_name, bridge in BRIDGES.items()
+    for stat_name, (icon, state_class) in BRIDGE_STATS.items()
+}
+
+DIAGNOSTIC_SENSORS_SCHEMA = cv.All({
+    cv.Optional(sensor_designator): sensor_schema
+    for sensor_designator, sensor_schema in DIAGNOSTIC_SENSORS.items()
+} | {
+    cv.Optional(sensor_designator): sensor_schema
+    for sensor_designator, (bridge_name, stat, sensor_schema) in BRIDGE_STAT_SENSORS.items()
+} | {
+    cv.Optional(CONF_ROUND_TRIP): ROUND_TRIP_SCHEMA,
+})
+
 SELECTS = {
     CONF_TEMPERATURE_SOURCE_SELECT: (
         "Temperature Source",
@@ -176,6 +296,8 @@ SELECTS_SCHEMA = cv.All({
 
 CONFIG_SCHEMA = BASE_SCHEMA.extend({
     cv.Optional(CONF_SENSORS, default={}): SENSORS_SCHEMA,
+    cv.Optional(CONF_DIAGNOSTIC_SENSORS, default={}): DIAGNOSTIC_SENSORS_SCHEMA,
+    cv.Optional(CONF_DIAGNOSTIC_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
     cv.Optional(CONF_SELECTS, default={}): SELECTS_SCHEMA,
 })
 
@@ -193,6 +315,8 @@ async def to_code(config):
         # Register thermostat with MUART
         ts_uart_component = await cg.get_variable(config[CONF_TS_UART])
         cg.add(getattr(muart_component, f"set_thermostat_uart")(ts_uart_component))
+        cg.add(muart_component.set_thermostat_cut_through(config[CONF_THERMOSTAT_CUT_THROUGH]))
+        cg.add(muart_component.set_thermostat_cache_max_age(config[CONF_THERMOSTAT_CACHE_MAX_AGE]))
         # Add sensor as source
         SELECTS[CONF_TEMPERATURE_SOURCE_SELECT][2].append("Thermostat")
 
@@ -209,6 +333,11 @@ async def to_code(config):
     if CONF_CUSTOM_FAN_MODES in config:
         cg.add(traits.set_supported_custom_fan_modes(config[CONF_CUSTOM_FAN_MODES]))
 
+    # Polling
+
+    for poll_designator, (poll_command, poll_default) in POLLING_INTERVALS.items():
+        cg.add(muart_component.set_poll_interval(poll_command, config[CONF_POLLING_INTERVALS][poll_designator]))
+
     # Sensors
 
     for sensor_designator, (sensor_name, sensor_schema, registration_function) in SENSORS.items():
@@ -223,6 +352,29 @@ async def to_code(config):
 
         cg.add(getattr(muart_component, f"set_{sensor_designator}_sensor")(sensor_component))
 
+    for sensor_designator in DIAGNOSTIC_SENSORS:
+        if sensor_conf := config[CONF_DIAGNOSTIC_SENSORS].get(sensor_designator):
+            sensor_component = await sensor.new_sensor(sensor_conf)
+            cg.add(getattr(muart_component, f"set_{sensor_designator}_sensor")(sensor_component))
+
+    for command_designator, command in ROUND_TRIP_COMMANDS.items():
+        command_conf = config[CONF_DIAGNOSTIC_SENSORS].get(CONF_ROUND_TRIP, {}).get(command_designator, {})
+        for statistic_designator, statistic in ROUND_TRIP_STATISTICS.items():
+            if sensor_conf := command_conf.get(statistic_designator):
+                sensor_component = await sensor.new_sensor(sensor_conf)
+                cg.add(muart_component.set_round_trip_sensor(command, statistic, sensor_component))
+
+    for sensor_designator, (bridge_name, stat, sensor_schema) in BRIDGE_STAT_SENSORS.items():
+        # Thermostat counters only make sense if we have a TS_UART
+        if (bridge_name == "thermostat") and (CONF_TS_UART not in config):
+            continue
+        if sensor_conf := config[CONF_DIAGNOSTIC_SENSORS].get(sensor_designator):
+            sensor_component = await sensor.new_sensor(sensor_conf)
+            cg.add(muart_component.set_bridge_stat_sensor(BRIDGES[bridge_name], stat, sensor_component))
+
+    cg.add(muart_component.set_diagnostic_interval(config[CONF_DIAGNOSTIC_INTERVAL]))
+    cg.add(muart_component.set_publish_debounce(config[CONF_PUBLISH_DEBOUNCE]))
+
     ### Selects
 
     # Add additional configured temperature sensors to the select menu
@@ -250,3 +402,12 @@ async def to_code(config):
         await cg.register_component(switch_component, am_switch_conf)
         await cg.register_parented(switch_component,muart_component)
 
+
+@automation.register_action(
+    "mitsubishi_uart.dump_flight_recorder",
+    DumpFlightRecorderAction,
+    automation.maybe_simple_id({cv.GenerateID(): cv.use_id(MitsubishiUART)}),
+)
+async def dump_flight_recorder_to_code(config, action_id, template_arg, args):
+    parent = await cg.get_variable(config[CONF_ID])
+    return cg.new_Pvariable(action_id, template_arg, parent)
@@ -86,12 +86,14 @@ void MitsubishiUART::control(const climate::ClimateCall &call) {
   // Swing?
 
   // We're assuming that every climate call *does* make some change worth sending to the heat pump
-  // Queue the packet to be sent first (so any subsequent update packets come *after* our changes)
+  // Set requests are sent ahead of any queued polls, and settings are re-read on the next update to confirm
   hp_bridge.sendPacket(setRequestPacket);
+  forcePoll(GetCommand::settings);
 
-  // Publish state and any sensor changes (shouldn't be any a a result of this function, but
-  // since they lazy-publish, no harm in trying)
-  doPublish();
+  // Publish the new climate state with anything else waiting, through the debounce like every other change (so a burst
+  // of calls, or a call amid incoming packets, publishes once)
+  hpState.markDirty(StateField::climate);
+  schedulePublish();
 };
 
 }  // namespace mitsubishi_uart
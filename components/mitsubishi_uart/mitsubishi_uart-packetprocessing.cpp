@@ -4,32 +4,143 @@ namespace esphome {
 namespace mitsubishi_uart {
 
 void MitsubishiUART::routePacket(const Packet &packet) {
+  // Every packet passes through here, so keep the latest heatpump get responses for answerFromCache()
+  if (packet.getSourceBridge() == SourceBridge::heatpump &&
+      packet.getPacketType() == static_cast<uint8_t>(PacketType::get_response)) {
+    responseCache.store(packet.frame(), millis());
+  }
+  // Set requests (ours, via their responses, or the thermostat's) change what the heatpump reports
+  if (packet.getPacketType() == static_cast<uint8_t>(PacketType::set_request) ||
+      (packet.getSourceBridge() == SourceBridge::heatpump &&
+       packet.getPacketType() == static_cast<uint8_t>(PacketType::set_response))) {
+    invalidateCachedResponses(packet.rawPacket().getCommand());
+  }
+
+  // Already sent on by cutThrough()
+  if (packet.rawPacket().isForwarded()) return;
+
   // If the packet is associated with the thermostat and just came from the thermostat, send it to the heatpump
   // If it came from the heatpump, send it back to the thermostat
   if (packet.getControllerAssociation() == ControllerAssociation::thermostat) {
     if (packet.getSourceBridge() == SourceBridge::thermostat) {
       hp_bridge.sendPacket(packet);
+      recordForwardingDelay(SourceBridge::thermostat);
     } else if (packet.getSourceBridge() == SourceBridge::heatpump) {
       ts_bridge->sendPacket(packet);
+      recordForwardingDelay(SourceBridge::heatpump);
     }
   }
 }
 
+/* In cut-through mode, frames belonging to the thermostat are queued for the other bridge as soon as their checksum
+has been validated, and are only decoded (for state snooping) afterwards.  Frames sent to the heatpump this way are
+sent ahead of anything else in its queue.  The frame itself is queued, not a copy, so it's marked as forwarded
+first (which is what puts it in the heatpump's cut-through lane).*/
+void MitsubishiUART::cutThrough(const FrameHandle &frame) {
+  if (!thermostatCutThrough || !ts_bridge) return;
+  const RawPacket &pkt = *frame;
+  if (pkt.getControllerAssociation() != ControllerAssociation::thermostat) return;
+
+  if (answerFromCache(pkt)) {
+    frame->setForwarded();
+    return;
+  }
+
+  // Whether remote temperatures are passed on depends on the selected temperature source, so they're always decoded first
+  if (pkt.getPacketType() == static_cast<uint8_t>(PacketType::set_request) &&
+      pkt.getCommand() == static_cast<uint8_t>(SetCommand::remote_temperature)) {
+    return;
+  }
+
+  MUARTBridge *destination = nullptr;
+  if (pkt.getSourceBridge() == SourceBridge::thermostat) {
+    destination = &hp_bridge;
+  } else if (pkt.getSourceBridge() == SourceBridge::heatpump) {
+    destination = ts_bridge.get();
+  } else {
+    return;
+  }
+
+  frame->setForwarded();
+  if (!destination->forwardFrame(frame)) {
+    // Not queued, so let routePacket() have another go once it's decoded
+    frame->setForwarded(false);
+    return;
+  }
+  recordForwardingDelay(pkt.getSourceBridge());
+}
+
+/* Answers a thermostat get request with a recent enough response from the cache, so that it doesn't need to be
+sent to the heatpump.  Returns true if the request was answered.*/
+bool MitsubishiUART::answerFromCache(const RawPacket &request) {
+  if (!ts_bridge || thermostatCacheMaxAgeMillis == 0) return false;
+  if (request.getSourceBridge() != SourceBridge::thermostat ||
+      request.getPacketType() != static_cast<uint8_t>(PacketType::get_request)) {
+    return false;
+  }
+
+  const RawPacket *cached = responseCache.lookup(request.getCommand(), millis(), thermostatCacheMaxAgeMillis);
+  if (!cached) {
+    cacheMisses++;
+    return false;
+  }
+
+  // Copied rather than shared, since the cached frame must keep its own controller association
+  FrameHandle response = framePool().acquire(*cached);
+  response->setControllerAssociation(ControllerAssociation::thermostat);
+  if (!ts_bridge->forwardFrame(response)) return false;
+
+  cacheHits++;
+  cacheBytesSaved += request.getLength() + response->getLength();
+  ESP_LOGV(TAG, "Answered thermostat get request %x from cache.", request.getCommand());
+  return true;
+}
+
+/* Drops the cached get responses a set command can change, so the thermostat reads back the new state (e.g. confirming
+its own setpoint change) rather than a response from before the change.*/
+void MitsubishiUART::invalidateCachedResponses(const uint8_t setCommand) {
+  switch (static_cast<SetCommand>(setCommand)) {
+    case SetCommand::settings:
+      responseCache.invalidate(static_cast<uint8_t>(GetCommand::settings));
+      responseCache.invalidate(static_cast<uint8_t>(GetCommand::status));
+      responseCache.invalidate(static_cast<uint8_t>(GetCommand::standby));
+      break;
+    case SetCommand::remote_temperature:
+      responseCache.invalidate(static_cast<uint8_t>(GetCommand::current_temp));
+      responseCache.invalidate(static_cast<uint8_t>(GetCommand::status));
+      break;
+    case SetCommand::thermostat_hello:
+      break;
+    default:
+      // Unknown effect, so nothing cached can be trusted
+      responseCache.clear();
+      break;
+  }
+}
+
+void MitsubishiUART::recordForwardingDelay(SourceBridge from) {
+  if (from == SourceBridge::thermostat) {
+    forwardingDelay[0].record(micros() - ts_bridge->getLastReceiveMicros());
+  } else {
+    forwardingDelay[1].record(micros() - hp_bridge.getLastReceiveMicros());
+  }
+}
+
 // Packet Handlers
 void MitsubishiUART::processPacket(const Packet &packet) {
   ESP_LOGI(TAG, "Generic unhandled packet type %x received.", packet.getPacketType());
-  ESP_LOGD(TAG, "%s", packet.to_string().c_str());
+  MUART_LOGD_PACKET(TAG, "", packet);
   routePacket(packet);
 };
 
 void MitsubishiUART::processPacket(const ConnectRequestPacket &packet) {
   // Nothing to be done for these except forward them along from thermostat to heat pump.
   // This method defined so that these packets are not "unhandled"
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
 };
 void MitsubishiUART::processPacket(const ConnectResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
   // Not sure if there's any needed content in this response, so assume we're connected.
   hpConnected = true;
@@ -39,29 +150,35 @@ void MitsubishiUART::processPacket(const ConnectResponsePacket &packet) {
 void MitsubishiUART::processPacket(const ExtendedConnectRequestPacket &packet) {
   // Nothing to be done for these except forward them along from thermostat to heat pump.
   // This method defined so that these packets are not "unhandled"
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
 };
 void MitsubishiUART::processPacket(const ExtendedConnectResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
   // Not sure if there's any needed content in this response, so assume we're connected.
   // TODO: Is there more useful info in these?
   hpConnected = true;
-  _capabilitiesCache = packet;
+  if (packet.frame().isOverflow()) {
+    // The overflow frame will be overwritten, so it can't be kept; ask again on the next update
+    ESP_LOGW(TAG, "Frame pool exhausted, capabilities not kept.");
+    _capabilitiesRequested = false;
+  } else {
+    _capabilitiesCache = packet;
+  }
   ESP_LOGI(TAG, "Received heat pump identification packet.");
 };
 
 void MitsubishiUART::processPacket(const GetRequestPacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
+  // These are just requests for information from the thermostat.  If we've seen a recent enough response
+  // from the heatpump, answer with that; otherwise pass the request on.
+  if (!packet.rawPacket().isForwarded() && answerFromCache(packet.rawPacket())) return;
   routePacket(packet);
-  // These are just requests for information from the thermostat.  For now, nothing to be done
-  // except route them.  In the future, we could use this to inject information for the thermostat
-  // or use a cached value.
 }
 
 void MitsubishiUART::processPacket(const SettingsGetResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
 
   // Mode
@@ -91,12 +208,12 @@ void MitsubishiUART::processPacket(const SettingsGetResponsePacket &packet) {
     mode = climate::CLIMATE_MODE_OFF;
   }
 
-  publishOnUpdate |= (old_mode != mode);
+  if (old_mode != mode) hpState.markDirty(StateField::climate);
 
   // Temperature
   const float old_target_temperature = target_temperature;
   target_temperature = packet.getTargetTemp();
-  publishOnUpdate |= (old_target_temperature != target_temperature);
+  if (old_target_temperature != target_temperature) hpState.markDirty(StateField::climate);
 
   // Fan
   static bool fanChanged = false;
@@ -121,82 +238,33 @@ void MitsubishiUART::processPacket(const SettingsGetResponsePacket &packet) {
       break;
   }
 
-  publishOnUpdate |= fanChanged;
+  if (fanChanged) hpState.markDirty(StateField::climate);
 
-  // TODO: It would probably be nice to have the enum->string mapping defined somewhere to avoid typos/errors
-  const std::string old_vane_position = vane_position_select->state;
-  switch(packet.getVane()) {
-    case SettingsSetRequestPacket::VANE_AUTO:
-      vane_position_select->state = "Auto";
-      break;
-    case SettingsSetRequestPacket::VANE_1:
-      vane_position_select->state = "1";
-      break;
-    case SettingsSetRequestPacket::VANE_2:
-      vane_position_select->state = "2";
-      break;
-    case SettingsSetRequestPacket::VANE_3:
-      vane_position_select->state = "3";
-      break;
-    case SettingsSetRequestPacket::VANE_4:
-      vane_position_select->state = "4";
-      break;
-    case SettingsSetRequestPacket::VANE_5:
-      vane_position_select->state = "5";
-      break;
-    case SettingsSetRequestPacket::VANE_SWING:
-      vane_position_select->state = "Swing";
-      break;
-    default:
-      ESP_LOGW(TAG, "Vane in unknown position %x", packet.getVane());
+  // Vanes (published by name, see vaneName() and horizontalVaneName())
+  if (vaneName(packet.getVane())) {
+    hpState.update(StateField::vane, hpState.vane, packet.getVane());
+  } else {
+    ESP_LOGW(TAG, "Vane in unknown position %x", packet.getVane());
   }
-  publishOnUpdate |= (old_vane_position != vane_position_select->state);
-
-
-  const std::string old_horizontal_vane_position = horizontal_vane_position_select->state;
-  switch(packet.getHorizontalVane()) {
-    case SettingsSetRequestPacket::HV_AUTO:
-      horizontal_vane_position_select->state = "Auto";
-      break;
-    case SettingsSetRequestPacket::HV_LEFT_FULL:
-      horizontal_vane_position_select->state = "<<";
-      break;
-    case SettingsSetRequestPacket::HV_LEFT:
-      horizontal_vane_position_select->state = "<";
-      break;
-    case SettingsSetRequestPacket::HV_CENTER:
-      horizontal_vane_position_select->state = "|";
-      break;
-    case SettingsSetRequestPacket::HV_RIGHT:
-      horizontal_vane_position_select->state = ">";
-      break;
-    case SettingsSetRequestPacket::HV_RIGHT_FULL:
-      horizontal_vane_position_select->state = ">>";
-      break;
-    case SettingsSetRequestPacket::HV_SPLIT:
-      horizontal_vane_position_select->state = "<>";
-      break;
-    case SettingsSetRequestPacket::HV_SWING:
-      horizontal_vane_position_select->state = "Swing";
-      break;
-    default:
-      ESP_LOGW(TAG, "Vane in unknown horizontal position %x", packet.getHorizontalVane());
+  if (horizontalVaneName(packet.getHorizontalVane())) {
+    hpState.update(StateField::horizontal_vane, hpState.horizontalVane, packet.getHorizontalVane());
+  } else {
+    ESP_LOGW(TAG, "Vane in unknown horizontal position %x", packet.getHorizontalVane());
   }
-  publishOnUpdate |= (old_horizontal_vane_position != horizontal_vane_position_select->state);
 };
 
 void MitsubishiUART::processPacket(const CurrentTempGetResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
   // This will be the same as the remote temperature if we're using a remote sensor, otherwise the internal temp
   const float old_current_temperature = current_temperature;
   current_temperature = packet.getCurrentTemp();
 
-  publishOnUpdate |= (old_current_temperature != current_temperature);
+  if (old_current_temperature != current_temperature) hpState.markDirty(StateField::climate);
 };
 
 void MitsubishiUART::processPacket(const StatusGetResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
   const climate::ClimateAction old_action = action;
 
@@ -243,79 +311,40 @@ void MitsubishiUART::processPacket(const StatusGetResponsePacket &packet) {
     action = climate::CLIMATE_ACTION_IDLE;
   }
 
-  publishOnUpdate |= (old_action != action);
-
+  if (old_action != action) hpState.markDirty(StateField::climate);
 
-  if (compressor_frequency_sensor) {
-    const float old_compressor_frequency = compressor_frequency_sensor->raw_state;
-
-    compressor_frequency_sensor->raw_state = packet.getCompressorFrequency();
-
-    publishOnUpdate |= (old_compressor_frequency != compressor_frequency_sensor->raw_state);
-  }
+  hpState.update(StateField::compressor_frequency, hpState.compressorFrequency, packet.getCompressorFrequency());
 };
 void MitsubishiUART::processPacket(const StandbyGetResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
 
-  if (service_filter_sensor) {
-    const bool old_service_filter = service_filter_sensor->state;
-    service_filter_sensor->state = packet.serviceFilter();
-    publishOnUpdate |= (old_service_filter != service_filter_sensor->state);
-  }
-
-  if (defrost_sensor) {
-    const bool old_defrost = defrost_sensor->state;
-    defrost_sensor->state = packet.inDefrost();
-    publishOnUpdate |= (old_defrost != defrost_sensor->state);
-  }
-
-  if (hot_adjust_sensor) {
-    const bool old_hot_adjust = hot_adjust_sensor->state;
-    hot_adjust_sensor->state = packet.inHotAdjust();
-    publishOnUpdate |= (old_hot_adjust != hot_adjust_sensor->state);
-  }
-
-  if (standby_sensor) {
-    const bool old_standby = standby_sensor->state;
-    standby_sensor->state = packet.inStandby();
-    publishOnUpdate |= (old_standby != standby_sensor->state);
-  }
-
-  if (actual_fan_sensor) {
-    const auto old_actual_fan = actual_fan_sensor->raw_state;
-    actual_fan_sensor->raw_state = ACTUAL_FAN_SPEED_NAMES[packet.getActualFanSpeed()];
-    publishOnUpdate |= (old_actual_fan != actual_fan_sensor->raw_state);
-  }
+  hpState.update(StateField::service_filter, hpState.serviceFilter, packet.serviceFilter());
+  hpState.update(StateField::defrost, hpState.defrost, packet.inDefrost());
+  hpState.update(StateField::hot_adjust, hpState.hotAdjust, packet.inHotAdjust());
+  hpState.update(StateField::standby, hpState.standby, packet.inStandby());
+  hpState.update(StateField::actual_fan, hpState.actualFanSpeed, packet.getActualFanSpeed());
 
   //TODO: Not sure what AutoMode does yet
 }
 
 void MitsubishiUART::processPacket(const ErrorStateGetResponsePacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
   routePacket(packet);
 
-  std::string oldErrorCode = error_code_sensor->raw_state;
-
-  // TODO: Include friendly text from JSON, somehow.
-  if (!packet.errorPresent()) {
-    error_code_sensor->raw_state = "No Error Reported";
-  } else if (auto rawCode = packet.getRawShortCode() != 0x00) {
-    // Not that it matters, but good for validation I guess.
-    if ((rawCode & 0x1F) > 0x15) {
-      ESP_LOGW(TAG, "Error short code %x had invalid low bits. This is an IT protocol violation!", rawCode);
-    }
-
-    error_code_sensor->raw_state = "Error " + packet.getShortCode();
-  } else {
-    error_code_sensor->raw_state = "Error " + to_string(packet.getErrorCode());
+  const uint8_t rawCode = packet.getRawShortCode();
+  // Not that it matters, but good for validation I guess.
+  if (rawCode != 0x00 && (rawCode & 0x1F) > 0x15) {
+    ESP_LOGW(TAG, "Error short code %x had invalid low bits. This is an IT protocol violation!", rawCode);
   }
 
-  publishOnUpdate |= (oldErrorCode != error_code_sensor->raw_state);
+  // The text is built when it's published (see doPublish)
+  hpState.update(StateField::error_code, hpState.errorCode, packet.getErrorCode());
+  hpState.update(StateField::error_code, hpState.errorShortCode, rawCode);
 }
 
 void MitsubishiUART::processPacket(const RemoteTemperatureSetRequestPacket &packet) {
-  ESP_LOGV(TAG, "Processing %s", packet.to_string().c_str());
+  MUART_LOGV_PACKET(TAG, "Processing ", packet);
 
   // Only send this temperature packet to the heatpump if Thermostat is the selected source,
   // or we're in passive mode (since in passive mode we're not generating any packets to
@@ -329,18 +358,12 @@ void MitsubishiUART::processPacket(const RemoteTemperatureSetRequestPacket &pack
   float t = packet.getRemoteTemperature();
   temperature_source_report(TEMPERATURE_SOURCE_THERMOSTAT, t);
 
-  if (thermostat_temperature_sensor) {
-    const float old_thermostat_temp = thermostat_temperature_sensor->raw_state;
-
-    thermostat_temperature_sensor->raw_state = t;
-
-    publishOnUpdate |= (old_thermostat_temp != thermostat_temperature_sensor->raw_state);
-  }
+  hpState.update(StateField::thermostat_temperature, hpState.thermostatTemperature, t);
 };
 void MitsubishiUART::processPacket(const RemoteTemperatureSetResponsePacket &packet) {
   routePacket(packet);
   ESP_LOGI(TAG, "Unhandled packet RemoteTemperatureSetResponsePacket received.");
-  ESP_LOGD(TAG, "%s", packet.to_string().c_str());
+  MUART_LOGD_PACKET(TAG, "", packet);
 };
 
 }  // namespace mitsubishi_uart
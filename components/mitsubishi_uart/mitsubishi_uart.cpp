@@ -17,6 +17,8 @@ MitsubishiUART::MitsubishiUART(uart::UARTComponent *hp_uart_comp) : hp_uart{*hp_
    */
   target_temperature = NAN;
   current_temperature = NAN;
+
+  hp_bridge.setFlightRecorder(&flight_recorder);
 }
 
 // Used to restore state of previous MUART-specific settings (like temperature source or pass-thru mode)
@@ -32,6 +34,9 @@ void MitsubishiUART::setup() {
   // is an easy way to prevent wierd conflicts if e.g. select options change.
   preferences_ = global_preferences->make_preference<MUARTPreferences>(get_object_id_hash() ^ fnv1_hash(App.get_compilation_time()));
   restore_preferences();
+
+  // Without any diagnostic sensors configured there's nothing to publish, so don't spend a timer on it
+  if (hasDiagnosticSensors()) set_interval("diagnostics", diagnosticIntervalMillis, [this]() { publishDiagnostics(); });
 }
 
 void MitsubishiUART::save_preferences() {
@@ -45,6 +50,7 @@ void MitsubishiUART::save_preferences() {
   }
 
   preferences_.save(&prefs);
+  savedTemperatureSource = currentTemperatureSource;
 }
 
 // Restores previously set values, or sets sane defaults
@@ -56,6 +62,7 @@ void MitsubishiUART::restore_preferences() {
     && temperature_source_select->has_index(prefs.currentTemperatureSourceIndex.value())
     && temperature_source_select->at(prefs.currentTemperatureSourceIndex.value()).has_value()) {
       currentTemperatureSource = temperature_source_select->at(prefs.currentTemperatureSourceIndex.value()).value();
+      savedTemperatureSource = currentTemperatureSource;
       temperature_source_select->publish_state(currentTemperatureSource);
       ESP_LOGCONFIG(TAG, "Preferences loaded.");
     } else {
@@ -81,13 +88,16 @@ void MitsubishiUART::sendIfActive(const Packet& packet) {
 
 /* Used for receiving and acting on incoming packets as soon as they're available.
   Because packet processing happens as part of the receiving process, packet processing
-  should not block for very long (e.g. no publishing inside the packet processing)
+  should not block for very long (e.g. no publishing inside the packet processing).  Any state
+  the packets changed is published a short debounce later instead (see schedulePublish).
 */
 void MitsubishiUART::loop() {
   // Loop bridge to handle sending and receiving packets
   hp_bridge.loop();
   if (ts_bridge) ts_bridge->loop();
 
+  if (hpState.anyDirty()) schedulePublish();
+
   // If it's been too long since we received a temperature update (and we're not set to Internal)
   if (((millis() - lastReceivedTemperature) > TEMPERATURE_SOURCE_TIMEOUT_MS) && (temperature_source_select->state != TEMPERATURE_SOURCE_INTERNAL)) {
     ESP_LOGW(TAG, "No temperature received from %s for %i milliseconds, reverting to Internal source", currentTemperatureSource.c_str(), TEMPERATURE_SOURCE_TIMEOUT_MS);
@@ -102,15 +112,42 @@ void MitsubishiUART::loop() {
 
 void MitsubishiUART::dump_config() {
   if (_capabilitiesCache.has_value()){
-    ESP_LOGCONFIG(TAG, "Discovered Capabilities: %s", _capabilitiesCache.value().to_string().c_str());
+    char buffer[PACKET_FORMAT_BUFFER_SIZE];
+    FormatBuffer out(buffer, sizeof(buffer));
+    formatPacket(out, _capabilitiesCache.value());
+    ESP_LOGCONFIG(TAG, "Discovered Capabilities: %s", buffer);
   }
+  for (const PollSchedule &poll : pollSchedule) {
+    ESP_LOGCONFIG(TAG, "Poll interval for %x: %ums%s", static_cast<uint8_t>(poll.command), poll.intervalMillis,
+                  poll.adaptive ? " (adaptive)" : "");
+  }
+  ESP_LOGCONFIG(TAG, "Polls skipped thanks to recent thermostat requests: %u", pollsSkipped);
+  ESP_LOGCONFIG(TAG, "Publish debounce: %ums", publishDebounceMillis);
+  hp_bridge.dumpStats();
+  ESP_LOGCONFIG(TAG, "Frame pool: %u/%u in use, exhausted %u times; %u/%u pinned",
+                static_cast<unsigned>(framePool().inUse()), static_cast<unsigned>(FRAME_POOL_SIZE),
+                framePool().exhaustedCount(), static_cast<unsigned>(framePool().pinnedCount()),
+                static_cast<unsigned>(FRAME_POOL_PINNED_SIZE));
+  if (ts_bridge) {
+    ts_bridge->dumpStats();
+    ESP_LOGCONFIG(TAG, "Thermostat cut-through: %s", YESNO(thermostatCutThrough));
+    ESP_LOGCONFIG(TAG, "Forwarded to heatpump: %u frames, avg %uus, max %uus", forwardingDelay[0].count,
+                  forwardingDelay[0].averageMicros(), forwardingDelay[0].maxMicros);
+    ESP_LOGCONFIG(TAG, "Forwarded to thermostat: %u frames, avg %uus, max %uus", forwardingDelay[1].count,
+                  forwardingDelay[1].averageMicros(), forwardingDelay[1].maxMicros);
+    const uint32_t lookups = cacheHits + cacheMisses;
+    ESP_LOGCONFIG(TAG, "Thermostat response cache (max age %ums): %u hits, %u misses (%u%% hit rate), %u heatpump bytes saved",
+                  thermostatCacheMaxAgeMillis, cacheHits, cacheMisses, lookups == 0 ? 0 : cacheHits * 100 / lookups,
+                  cacheBytesSaved);
+  }
+  // The frames themselves are only logged by the dump_flight_recorder action
+  ESP_LOGCONFIG(TAG, "Flight recorder: %u frames", static_cast<unsigned>(flight_recorder.size()));
 }
 
 /* Called periodically as PollingComponent; used to send packets to connect or request updates.
 
-Possible TODO: If we only publish during updates, since data is received during loop, updates will always
-be about `update_interval` late from their actual time.  Generally the update interval should be low enough
-(default is 5seconds) this won't pose a practical problem.
+Publishing doesn't wait for updates: changes are published by schedulePublish() as soon as the packets carrying them
+are processed, so the update interval only sets how often the heatpump is polled.
 */
 void MitsubishiUART::update() {
   // TODO: Temporarily wait 5 seconds on startup to help with viewing logs
@@ -134,58 +171,199 @@ void MitsubishiUART::update() {
     )
   }
 
-  // Before requesting additional updates, publish any changes waiting from packets received
-  if (publishOnUpdate){
-    doPublish();
+  // Request updates from the heatpump
+  IFACTIVE(sendPolls();)
+}
+
+/* Each command is polled on its own interval, rather than requesting everything on every update.  Status and
+standby are polled more often while the compressor is running or the unit is defrosting, since that's when they
+change.  A request isn't sent again if the previous one is still queued or awaiting a response.
+
+Responses to the thermostat's requests update our state too, so a poll is skipped if the latest response to the same
+command was requested by the thermostat and was seen within the poll interval.  The interval then restarts from when that response was seen.
+Forced polls are always sent.
+*/
+void MitsubishiUART::sendPolls() {
+  const uint32_t now = millis();
+  const bool active = isUnitActive();
+
+  for (PollSchedule &poll : pollSchedule) {
+    if (!poll.isDue(now, active)) continue;
+    if (hp_bridge.isRequestPending(PacketType::get_request, static_cast<uint8_t>(poll.command))) continue;
+
+    const uint8_t command = static_cast<uint8_t>(poll.command);
+    const RawPacket *snooped = responseCache.lookup(command, now, poll.currentInterval(active));
+    if (!poll.forced && snooped && snooped->getControllerAssociation() == ControllerAssociation::thermostat) {
+      poll.lastSentMillis = now - responseCache.age(command, now);
+      pollsSkipped++;
+      continue;
+    }
+
+    if (hp_bridge.sendPacket(GetRequestPacket::getInstance(poll.command))) {
+      poll.lastSentMillis = now;
+      poll.forced = false;
+    }
+  }
+}
+
+void MitsubishiUART::forcePoll(const GetCommand command) {
+  for (PollSchedule &poll : pollSchedule) {
+    if (poll.command == command) poll.forced = true;
+  }
+}
 
-    publishOnUpdate = false;
+void MitsubishiUART::set_poll_interval(const GetCommand command, const uint32_t interval_ms) {
+  for (PollSchedule &poll : pollSchedule) {
+    if (poll.command == command) poll.intervalMillis = interval_ms;
   }
+}
 
-  IFACTIVE(
-  // Request an update from the heatpump
-  // TODO: This isn't a problem *yet*, but sending all these packets every loop might start to cause some issues in
-  //       certain configurations or setups. We may want to consider only asking for certain packets on a rarer cadence,
-  //       depending on their utility (e.g. we dont need to check for errors every loop).
-  hp_bridge.sendPacket(GetRequestPacket::getSettingsInstance()); // Needs to be done before status packet for mode logic to work
-  hp_bridge.sendPacket(GetRequestPacket::getStandbyInstance());
-  hp_bridge.sendPacket(GetRequestPacket::getStatusInstance());
-  hp_bridge.sendPacket(GetRequestPacket::getCurrentTempInstance());
-  hp_bridge.sendPacket(GetRequestPacket::getErrorInfoInstance());
-  )
+/* Packets often arrive in bursts (e.g. a poll of several commands, or the thermostat's requests and their responses),
+so publishing waits publishDebounceMillis after the first change to publish everything that changed in the meantime
+together.  Later changes don't push the publish back, so a steady stream of packets can't delay it indefinitely.
+*/
+void MitsubishiUART::schedulePublish() {
+  if (publishScheduled) return;
+  publishScheduled = true;
+  set_timeout("publish", publishDebounceMillis, [this]() {
+    publishScheduled = false;
+    if (hpState.anyDirty()) doPublish();
+  });
 }
 
+// Publishes only the entities whose state has changed since they were last published
 void MitsubishiUART::doPublish() {
-  publish_state();
-  vane_position_select->publish_state(vane_position_select->state);
-  horizontal_vane_position_select->publish_state(horizontal_vane_position_select->state);
-  save_preferences(); // We can save this every time we publish as writes to flash are by default collected and delayed
-
-  // Check sensors and publish if needed.
-  // This is a bit of a hack to avoid needing to publish sensor data immediately as packets arrive.
-  // Instead, packet data is written directly to `raw_state` (which doesn't update `state`).  If they
-  // differ, calling `publish_state` will update `state` so that it won't be published later
-  if (thermostat_temperature_sensor && (thermostat_temperature_sensor->raw_state != thermostat_temperature_sensor->state)) {
-    ESP_LOGI(TAG, "Thermostat temp differs, do publish");
-    thermostat_temperature_sensor->publish_state(thermostat_temperature_sensor->raw_state);
+  if (hpState.isDirty(StateField::climate)) publish_state();
+  if (hpState.isDirty(StateField::vane)) vane_position_select->publish_state(vaneName(hpState.vane));
+  if (hpState.isDirty(StateField::horizontal_vane)) {
+    horizontal_vane_position_select->publish_state(horizontalVaneName(hpState.horizontalVane));
+  }
+  // The temperature source is the only preference, so there's nothing to write unless it has been changed
+  if (currentTemperatureSource != savedTemperatureSource) save_preferences();
+
+  if (thermostat_temperature_sensor && hpState.isDirty(StateField::thermostat_temperature)) {
+    thermostat_temperature_sensor->publish_state(hpState.thermostatTemperature);
   }
-  if (compressor_frequency_sensor && (compressor_frequency_sensor->raw_state != compressor_frequency_sensor->state)) {
-    ESP_LOGI(TAG, "Compressor frequency differs, do publish");
-    compressor_frequency_sensor->publish_state(compressor_frequency_sensor->raw_state);
+  if (compressor_frequency_sensor && hpState.isDirty(StateField::compressor_frequency)) {
+    compressor_frequency_sensor->publish_state(hpState.compressorFrequency);
   }
-  if (actual_fan_sensor && (actual_fan_sensor->raw_state != actual_fan_sensor->state)) {
-    ESP_LOGI(TAG, "Actual fan speed differs, do publish");
-    actual_fan_sensor->publish_state(actual_fan_sensor->raw_state);
+  if (actual_fan_sensor && hpState.isDirty(StateField::actual_fan)) {
+    if (hpState.actualFanSpeed < ACTUAL_FAN_SPEED_NAMES.size()) {
+      actual_fan_sensor->publish_state(ACTUAL_FAN_SPEED_NAMES[hpState.actualFanSpeed]);
+    } else {
+      ESP_LOGW(TAG, "Unknown actual fan speed %x", hpState.actualFanSpeed);
+    }
   }
-  if (error_code_sensor && (error_code_sensor->raw_state != error_code_sensor->state)) {
-    ESP_LOGI(TAG, "Error code state differs, do publish");
-    error_code_sensor->publish_state(error_code_sensor->raw_state);
+  if (service_filter_sensor && hpState.isDirty(StateField::service_filter)) {
+    service_filter_sensor->publish_state(hpState.serviceFilter);
   }
+  if (defrost_sensor && hpState.isDirty(StateField::defrost)) defrost_sensor->publish_state(hpState.defrost);
+  if (hot_adjust_sensor && hpState.isDirty(StateField::hot_adjust)) hot_adjust_sensor->publish_state(hpState.hotAdjust);
+  if (standby_sensor && hpState.isDirty(StateField::standby)) standby_sensor->publish_state(hpState.standby);
+
+  // TODO: Include friendly text from JSON, somehow.
+  if (error_code_sensor && hpState.isDirty(StateField::error_code)) {
+    if (hpState.errorCode == 0x8000 && hpState.errorShortCode == 0x00) {
+      error_code_sensor->publish_state("No Error Reported");
+    } else if (hpState.errorShortCode != 0x00) {
+      error_code_sensor->publish_state("Error " + ErrorStateGetResponsePacket::shortCodeName(hpState.errorShortCode));
+    } else {
+      error_code_sensor->publish_state("Error " + to_string(hpState.errorCode));
+    }
+  }
+
+  hpState.clearDirty();
+}
+
+const char *MitsubishiUART::vaneName(const uint8_t vane) {
+  switch (vane) {
+    case SettingsSetRequestPacket::VANE_AUTO:
+      return "Auto";
+    case SettingsSetRequestPacket::VANE_1:
+      return "1";
+    case SettingsSetRequestPacket::VANE_2:
+      return "2";
+    case SettingsSetRequestPacket::VANE_3:
+      return "3";
+    case SettingsSetRequestPacket::VANE_4:
+      return "4";
+    case SettingsSetRequestPacket::VANE_5:
+      return "5";
+    case SettingsSetRequestPacket::VANE_SWING:
+      return "Swing";
+    default:
+      return nullptr;
+  }
+}
+
+const char *MitsubishiUART::horizontalVaneName(const uint8_t horizontal_vane) {
+  switch (horizontal_vane) {
+    case SettingsSetRequestPacket::HV_AUTO:
+      return "Auto";
+    case SettingsSetRequestPacket::HV_LEFT_FULL:
+      return "<<";
+    case SettingsSetRequestPacket::HV_LEFT:
+      return "<";
+    case SettingsSetRequestPacket::HV_CENTER:
+      return "|";
+    case SettingsSetRequestPacket::HV_RIGHT:
+      return ">";
+    case SettingsSetRequestPacket::HV_RIGHT_FULL:
+      return ">>";
+    case SettingsSetRequestPacket::HV_SPLIT:
+      return "<>";
+    case SettingsSetRequestPacket::HV_SWING:
+      return "Swing";
+    default:
+      return nullptr;
+  }
+}
+
+// True if any of the sensors publishDiagnostics publishes to is configured
+bool MitsubishiUART::hasDiagnosticSensors() const {
+  if (round_trip_p50_sensor || round_trip_p95_sensor || round_trip_max_sensor) return true;
+  for (const auto &sensors : round_trip_command_sensors) {
+    for (const sensor::Sensor *sensor : sensors) {
+      if (sensor) return true;
+    }
+  }
+  for (const auto &sensors : bridge_stat_sensors) {
+    for (const sensor::Sensor *sensor : sensors) {
+      if (sensor) return true;
+    }
+  }
+  return false;
+}
+
+// Publishes bridge diagnostics to any configured diagnostic sensors
+void MitsubishiUART::publishDiagnostics() {
+  const MUARTBridge *bridges[2] = {&hp_bridge, ts_bridge.get()};
+  for (size_t b = 0; b < 2; b++) {
+    if (!bridges[b]) continue;
+    for (size_t s = 0; s < static_cast<size_t>(BridgeStat::count); s++) {
+      if (bridge_stat_sensors[b][s]) bridge_stat_sensors[b][s]->publish_state(bridges[b]->getStat(static_cast<BridgeStat>(s)));
+    }
+  }
+
+  publishRoundTrip(hp_bridge.getRoundTripHistogram(), round_trip_p50_sensor, round_trip_p95_sensor,
+                   round_trip_max_sensor);
+  for (size_t c = 0; c < ROUND_TRIP_COMMAND_COUNT; c++) {
+    sensor::Sensor *const *sensors = round_trip_command_sensors[c];
+    publishRoundTrip(hp_bridge.getRoundTripHistogram(static_cast<RoundTripCommand>(c)),
+                     sensors[static_cast<size_t>(RoundTripStatistic::p50)],
+                     sensors[static_cast<size_t>(RoundTripStatistic::p95)],
+                     sensors[static_cast<size_t>(RoundTripStatistic::max)]);
+  }
+}
+
+// Publishes a round trip histogram to whichever of its sensors are configured, once it has any samples
+void MitsubishiUART::publishRoundTrip(const LatencyHistogram &histogram, sensor::Sensor *p50, sensor::Sensor *p95,
+                                      sensor::Sensor *max) {
+  if (histogram.count() == 0) return;
 
-  // Binary sensors automatically dedup publishes (I think) and so will only actually publish on change
-  service_filter_sensor->publish_state(service_filter_sensor->state);
-  defrost_sensor->publish_state(defrost_sensor->state);
-  hot_adjust_sensor->publish_state(hot_adjust_sensor->state);
-  standby_sensor->publish_state(standby_sensor->state);
+  if (p50) p50->publish_state(histogram.percentile(0.5f));
+  if (p95) p95->publish_state(histogram.percentile(0.95f));
+  if (max) max->publish_state(histogram.max());
 }
 
 bool MitsubishiUART::select_temperature_source(const std::string &state) {
@@ -230,7 +408,11 @@ bool MitsubishiUART::select_vane_position(const std::string &state) {
   }
 
 
-  hp_bridge.sendPacket(SettingsSetRequestPacket().setVane(positionByte));
+  // Only publish optimistically if the packet was actually queued
+  if (!hp_bridge.sendPacket(SettingsSetRequestPacket().setVane(positionByte))) return false;
+  // Assume it took, so that the select is corrected on the next settings response if it didn't
+  hpState.vane = positionByte;
+  forcePoll(GetCommand::settings);
   return true;
 }
 
@@ -262,7 +444,11 @@ bool MitsubishiUART::select_horizontal_vane_position(const std::string &state) {
     return false;
   }
 
-  hp_bridge.sendPacket(SettingsSetRequestPacket().setHorizontalVane(positionByte));
+  // Only publish optimistically if the packet was actually queued
+  if (!hp_bridge.sendPacket(SettingsSetRequestPacket().setHorizontalVane(positionByte))) return false;
+  // Assume it took, so that the select is corrected on the next settings response if it didn't
+  hpState.horizontalVane = positionByte;
+  forcePoll(GetCommand::settings);
   return true;
 }
 
@@ -4,11 +4,16 @@
 #include "esphome/core/component.h"
 #include "esphome/core/preferences.h"
 #include "esphome/components/uart/uart.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/select/select.h"
 #include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
 #include "muart_packet.h"
 #include "muart_bridge.h"
+#include "muart_responsecache.h"
+#include "muart_state.h"
+#include <memory>
 #include <map>
 
 namespace esphome {
@@ -27,6 +32,53 @@ const uint32_t TEMPERATURE_SOURCE_TIMEOUT_MS = 420000; // (7min) The heatpump wi
 
 const std::string TEMPERATURE_SOURCE_THERMOSTAT = "Thermostat";
 
+// Default polling intervals for each requested command
+const uint32_t POLL_INTERVAL_SETTINGS_MS = 10000;
+const uint32_t POLL_INTERVAL_STANDBY_MS = 30000;
+const uint32_t POLL_INTERVAL_STATUS_MS = 30000;
+const uint32_t POLL_INTERVAL_CURRENT_TEMP_MS = 30000;
+const uint32_t POLL_INTERVAL_ERROR_INFO_MS = 300000;
+// Adaptive commands are polled this many times as often while the unit is running or defrosting
+const uint32_t ACTIVE_POLL_SPEEDUP = 3;
+
+// Round trip statistics that can be published for each type of request (see set_round_trip_sensor)
+enum class RoundTripStatistic : uint8_t {
+  p50,
+  p95,
+  max,
+  count
+};
+
+// Tracks when a get request should next be sent by update()
+struct PollSchedule {
+  GetCommand command;
+  uint32_t intervalMillis;
+  bool adaptive;              // Poll more often while the unit is active
+  bool forced = true;         // Send on the next update regardless of interval (always polled once at startup)
+  uint32_t lastSentMillis = 0;
+
+  uint32_t currentInterval(bool unitActive) const {
+    return (adaptive && unitActive) ? intervalMillis / ACTIVE_POLL_SPEEDUP : intervalMillis;
+  }
+  bool isDue(uint32_t now, bool unitActive) const {
+    return forced || (now - lastSentMillis >= currentInterval(unitActive));
+  }
+};
+
+// How long frames took to be forwarded between bridges, from the end of the frame arriving to being queued
+struct ForwardingStats {
+  uint32_t count = 0;
+  uint32_t totalMicros = 0;
+  uint32_t maxMicros = 0;
+
+  void record(uint32_t delayMicros) {
+    count++;
+    totalMicros += delayMicros;
+    if (delayMicros > maxMicros) maxMicros = delayMicros;
+  }
+  uint32_t averageMicros() const { return count == 0 ? 0 : totalMicros / count; }
+};
+
 // these names come from Kumo. They are bad, but I am also too lazy to think of better names. they also
 // may not map perfectly yet?
 const std::array<std::string, 7> ACTUAL_FAN_SPEED_NAMES = {"Off", "Very Low", "Quiet", "Low", "Powerful",
@@ -66,7 +118,8 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   void set_thermostat_uart(uart::UARTComponent *uart) {
     ESP_LOGCONFIG(TAG, "Thermostat uart was set.");
     ts_uart = uart;
-    ts_bridge = new ThermostatBridge(ts_uart, static_cast<PacketProcessor*>(this));
+    ts_bridge.reset(new ThermostatBridge(ts_uart, static_cast<PacketProcessor*>(this)));
+    ts_bridge->setFlightRecorder(&flight_recorder);
   }
 
   // Sensor setters
@@ -79,13 +132,29 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   void set_standby_sensor(binary_sensor::BinarySensor *sensor) {standby_sensor = sensor;};
   void set_error_code_sensor(text_sensor::TextSensor *sensor) { error_code_sensor = sensor; };
 
+  // Diagnostic sensor setters
+  void set_round_trip_p50_sensor(sensor::Sensor *sensor) { round_trip_p50_sensor = sensor; };
+  void set_round_trip_p95_sensor(sensor::Sensor *sensor) { round_trip_p95_sensor = sensor; };
+  void set_round_trip_max_sensor(sensor::Sensor *sensor) { round_trip_max_sensor = sensor; };
+  void set_round_trip_sensor(const RoundTripCommand command, const RoundTripStatistic statistic, sensor::Sensor *sensor) {
+    round_trip_command_sensors[static_cast<size_t>(command)][static_cast<size_t>(statistic)] = sensor;
+  }
+  void set_bridge_stat_sensor(const SourceBridge bridge, const BridgeStat stat, sensor::Sensor *sensor) {
+    bridge_stat_sensors[bridge == SourceBridge::thermostat ? 1 : 0][static_cast<size_t>(stat)] = sensor;
+  };
+  void set_diagnostic_interval(const uint32_t interval_ms) { diagnosticIntervalMillis = interval_ms; };
+  void set_publish_debounce(const uint32_t debounce_ms) { publishDebounceMillis = debounce_ms; };
+
+  // Logs the frames held by the flight recorder
+  void dump_flight_recorder() const { flight_recorder.dump(); };
+
   // Select setters
   void set_temperature_source_select(select::Select *select) {temperature_source_select = select;};
   void set_vane_position_select(select::Select *select) {vane_position_select = select;};
   void set_horizontal_vane_position_select(select::Select *select) {horizontal_vane_position_select = select;};
 
   // Returns true if select was valid (even if not yet successful) to indicate select component
-  // should optimistically publish
+  // should optimistically publish.  Returns false if the resulting packet couldn't be queued.
   bool select_temperature_source(const std::string &state);
   bool select_vane_position(const std::string &state);
   bool select_horizontal_vane_position(const std::string &state);
@@ -96,8 +165,22 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
   // Turns on or off actively sending packets
   void set_active_mode(const bool active) {active_mode = active;};
 
+  // Sets how often a get request is sent to the heatpump
+  void set_poll_interval(const GetCommand command, const uint32_t interval_ms);
+
+  // Forward thermostat frames as soon as their checksum is validated, before decoding them
+  void set_thermostat_cut_through(const bool enabled) { thermostatCutThrough = enabled; };
+
+  // Thermostat get requests are answered from cached heatpump responses no older than this (0, the default, disables it)
+  void set_thermostat_cache_max_age(const uint32_t max_age_ms) { thermostatCacheMaxAgeMillis = max_age_ms; };
+
+  void cutThrough(const FrameHandle &frame) override;
+
   protected:
     void routePacket(const Packet &packet);
+    void recordForwardingDelay(SourceBridge from);
+    bool answerFromCache(const RawPacket &request);
+    void invalidateCachedResponses(uint8_t setCommand);
 
     void processPacket(const Packet &packet);
     void processPacket(const ConnectRequestPacket &packet);
@@ -114,6 +197,22 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
     void processPacket(const RemoteTemperatureSetResponsePacket &packet);
 
     void doPublish();
+    // Publishes any dirty state once the debounce has elapsed (does nothing if a publish is already scheduled)
+    void schedulePublish();
+    // Names of the vane positions as shown by the selects, or nullptr for an unknown position
+    static const char *vaneName(uint8_t vane);
+    static const char *horizontalVaneName(uint8_t horizontal_vane);
+    bool hasDiagnosticSensors() const;
+    void publishDiagnostics();
+    static void publishRoundTrip(const LatencyHistogram &histogram, sensor::Sensor *p50, sensor::Sensor *p95,
+                                 sensor::Sensor *max);
+
+    // Sends any get requests that are due
+    void sendPolls();
+    // Causes the specified command to be polled on the next update
+    void forcePoll(GetCommand command);
+    // Is the unit doing something that warrants polling status more often
+    bool isUnitActive() const { return hpState.compressorFrequency > 0 || hpState.defrost; }
 
   private:
     // Default climate_traits for MUART
@@ -136,18 +235,42 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
     HeatpumpBridge hp_bridge;
     // UARTComponent connected to thermostat
     uart::UARTComponent *ts_uart = nullptr;
-    // UART packet wrapper for heatpump
-    ThermostatBridge *ts_bridge = nullptr;
+    // UART packet wrapper for thermostat
+    std::unique_ptr<ThermostatBridge> ts_bridge;
+    // Last few frames sent or received by either bridge
+    FlightRecorder flight_recorder;
 
 
     // Are we connected to the heatpump?
     bool hpConnected = false;
-    // Should we call publish on the next update?
-    bool publishOnUpdate = false;
+    // Decoded state, published shortly after it changes (see schedulePublish)
+    HeatpumpState hpState;
+    uint32_t publishDebounceMillis = 50;
+    bool publishScheduled = false;
 
     optional<ExtendedConnectResponsePacket> _capabilitiesCache;
     bool _capabilitiesRequested = false;
 
+    // Get requests sent by update().  Settings needs to come before status for mode logic to work.
+    std::array<PollSchedule, 5> pollSchedule = {{
+      {GetCommand::settings, POLL_INTERVAL_SETTINGS_MS, false},
+      {GetCommand::standby, POLL_INTERVAL_STANDBY_MS, true},
+      {GetCommand::status, POLL_INTERVAL_STATUS_MS, true},
+      {GetCommand::current_temp, POLL_INTERVAL_CURRENT_TEMP_MS, false},
+      {GetCommand::error_info, POLL_INTERVAL_ERROR_INFO_MS, false},
+    }};
+    bool thermostatCutThrough = false;
+    // Indexed by the bridge the frame was forwarded to: [heatpump, thermostat]
+    ForwardingStats forwardingDelay[2];
+
+    // Latest get response for each command, used to answer the thermostat
+    ResponseCache responseCache;
+    uint32_t thermostatCacheMaxAgeMillis = 0;
+    uint32_t cacheHits = 0;
+    uint32_t cacheMisses = 0;
+    uint32_t cacheBytesSaved = 0;    // Heatpump bus bytes not sent or received thanks to cache hits
+    uint32_t pollsSkipped = 0;       // Polls not sent because the thermostat had recently fetched the same data
+
     // Preferences
     void save_preferences();
     void restore_preferences();
@@ -164,6 +287,15 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
     binary_sensor::BinarySensor *standby_sensor = nullptr;
     text_sensor::TextSensor *error_code_sensor = nullptr;
 
+    // Diagnostic sensors
+    sensor::Sensor *round_trip_p50_sensor = nullptr;
+    sensor::Sensor *round_trip_p95_sensor = nullptr;
+    sensor::Sensor *round_trip_max_sensor = nullptr;
+    // Bridge health counters, indexed by [heatpump, thermostat][BridgeStat]
+    sensor::Sensor *round_trip_command_sensors[ROUND_TRIP_COMMAND_COUNT][static_cast<size_t>(RoundTripStatistic::count)]{};
+    sensor::Sensor *bridge_stat_sensors[2][static_cast<size_t>(BridgeStat::count)]{};
+    uint32_t diagnosticIntervalMillis = 60000;
+
     // Selects
     select::Select *temperature_source_select;
     select::Select *vane_position_select;
@@ -172,6 +304,7 @@ class MitsubishiUART : public PollingComponent, public climate::Climate, public
     // Temperature select extras
     std::map<std::string, size_t> temp_select_map; // Used to map strings to indexes for preference storage
     std::string currentTemperatureSource = TEMPERATURE_SOURCE_INTERNAL;
+    std::string savedTemperatureSource;  // As last saved to (or loaded from) preferences
     uint32_t lastReceivedTemperature = millis();
 
     void sendIfActive(const Packet& packet);
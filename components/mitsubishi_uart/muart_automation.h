@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "mitsubishi_uart.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// Logs the contents of the flight recorder (mitsubishi_uart.dump_flight_recorder)
+template<typename... Ts> class DumpFlightRecorderAction : public Action<Ts...>, public Parented<MitsubishiUART> {
+ public:
+  using Parented<MitsubishiUART>::Parented;
+
+  void play(Ts... x) override { this->parent_->dump_flight_recorder(); }
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
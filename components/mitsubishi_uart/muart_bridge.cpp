@@ -5,200 +5,452 @@ namespace mitsubishi_uart {
 
 MUARTBridge::MUARTBridge(uart::UARTComponent *uart_component, PacketProcessor *packet_processor) : uart_comp{*uart_component}, pkt_processor{*packet_processor} {}
 
-// The heatpump loop expects responses for most sent packets, so it tracks the last send packet and wait for a response
+/* The heatpump loop expects responses for most sent packets, so it tracks sent requests and waits for a response
+before sending the next packet.  Incoming responses are matched to their request (see TransactionTable) so that
+they're associated with the controller that asked for them.
+
+How long to wait for a response adapts to how quickly the heatpump has been answering (see ResponseTimeEstimator).
+Requests that time out are retried with exponential backoff according to MAX_RETRIES for their priority, as long as
+the retry fits within MAX_RETRY_WINDOW_MS.*/
 void HeatpumpBridge::loop() {
+  transactions.expire(millis());
 
   // Try to get a packet
-  if (optional<RawPacket> pkt = receiveRawPacket(SourceBridge::heatpump, packetAwaitingResponse.has_value() ? packetAwaitingResponse.value().getControllerAssociation() : ControllerAssociation::muart)) {
-    ESP_LOGV(BRIDGE_TAG, "Parsing %x heatpump packet", pkt.value().getPacketType());
+  if (FrameHandle frame = receiveRawPacket(SourceBridge::heatpump, ControllerAssociation::muart)) {
+    RawPacket &pkt = *frame;
+    ESP_LOGV(BRIDGE_TAG, "Parsing %x heatpump packet", pkt.getPacketType());
     // Check the packet's checksum and either process it, or log an error
-    if (pkt.value().isChecksumValid()) {
-      // If we're waiting for a response, associate the incomming packet with the request packet
-      classifyAndProcessRawPacket(pkt.value());
+    if (pkt.isChecksumValid()) {
+      correlateResponse(pkt);
+      pkt.setResponseExpected(isResponseExpected(pkt));
+      pkt_processor.cutThrough(frame);
+      classifyAndProcessRawPacket(frame);
     } else {
-      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s", format_hex_pretty(&pkt.value().getBytes()[0], pkt.value().getLength()).c_str());
+      countStat(BridgeStat::checksum_failures);
+      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s", format_hex_pretty(&pkt.getBytes()[0], pkt.getLength()).c_str());
     }
+  } else if (!transactions.hasLive() && !pkt_queue.empty()) {
+    // If we're not waiting for a response and there's a packet in the queue...
+    const uint32_t now = millis();
+    const int lane = pkt_queue.nextLane(now);
+    const QueuedPacket &queued = pkt_queue.lane(lane).front();
+
+    MUART_LOGV_PACKET(BRIDGE_TAG, "Sending to heatpump ", *queued.packet);
+    writeRawPacket(*queued.packet);
 
-    // If there was a packet waiting for a response, remove it.
-    // TODO: This incoming packet wasn't *nessesarily* a response, but for now
-    // it's probably not worth checking to make sure it matches.
-    if (packetAwaitingResponse.has_value()) {
-      packetAwaitingResponse.reset();
+    // If the packet expects a response, track it so the response can be matched
+    if (queued.responseExpected){
+      transactions.add(queued.packet, packet_sent_millis, responseTime.getTimeout(), MAX_RETRIES[lane]);
     }
-  } else if (!packetAwaitingResponse.has_value() && !pkt_queue.empty()) {
-    // If we're not waiting for a response and there's a packet in the queue...
 
-    // If the packet expects a response, add it to the awaitingResponse variable
-    if (pkt_queue.front().isResponseExpected()){
-      packetAwaitingResponse = pkt_queue.front();
+    // Remove packet from queue
+    pkt_queue.pop(lane, now);
+  } else if (Transaction *txn = transactions.overdue(millis())) {
+    const uint32_t backoffMillis = std::min(txn->timeoutMillis * 2, MAX_BACKOFF_TIMEOUT_MS);
+    const uint32_t waitedMillis = millis() - txn->firstSentMillis;
+    if (txn->retriesLeft > 0 && waitedMillis + backoffMillis <= MAX_RETRY_WINDOW_MS) {
+      // Back off and try again
+      txn->retriesLeft--;
+      txn->attempts++;
+      txn->timeoutMillis = backoffMillis;
+      retriedRequests++;
+      ESP_LOGD(BRIDGE_TAG, "Retrying %x packet (attempt %u).", txn->requestType(), txn->attempts);
+      writeRawPacket(*txn->request);
+      txn->sentMillis = packet_sent_millis;
+    } else {
+      // We've been waiting too long for a response, stop blocking the queue (a late response will still be matched)
+      txn->timedOut = true;
+      countStat(BridgeStat::timeouts);
+      ESP_LOGW(BRIDGE_TAG, "Timeout waiting for response to %x packet.", txn->requestType());
     }
+  }
+}
 
-    ESP_LOGV(BRIDGE_TAG, "Sending to heatpump %s", pkt_queue.front().to_string().c_str());
-    writeRawPacket(pkt_queue.front().rawPacket());
-    packet_sent_millis = millis();
+/* Finds the request this packet is a response to, and associates the packet with the same controller.  Responses
+that don't match a request are left associated with MUART, so they're processed but never sent to the thermostat.*/
+void HeatpumpBridge::correlateResponse(RawPacket &pkt) {
+  if (!TransactionTable::isResponse(pkt.getPacketType())) return;
 
-    // Remove packet from queue
-    pkt_queue.pop();
-  } else if (packetAwaitingResponse.has_value() && (millis() - packet_sent_millis > RESPONSE_TIMEOUT_MS)) {
-    // We've been waiting too long for a response, give up
-    // TODO: We could potentially retry here, but that seems unnecessary
-    packetAwaitingResponse.reset();
-    ESP_LOGW(BRIDGE_TAG, "Timeout waiting for response to %x packet.", packetAwaitingResponse.value().getPacketType());
+  const bool wasWaiting = transactions.hasLive();
+  if (optional<Transaction> txn = transactions.match(pkt)) {
+    if (txn.value().timedOut) {
+      lateResponses++;
+      ESP_LOGD(BRIDGE_TAG, "Accepted late response %x to %x packet.", pkt.getPacketType(), txn.value().requestType());
+    }
+    // Only sample requests that weren't retried, since it's ambiguous which attempt a retried response belongs to
+    if (txn.value().attempts == 1) {
+      const uint32_t roundTripMillis = millis() - txn.value().sentMillis;
+      responseTime.addSample(roundTripMillis);
+      recordRoundTrip(*txn.value().request, roundTripMillis);
+    }
+    pkt.setControllerAssociation(txn.value().controllerAssociation());
+  } else if (wasWaiting) {
+    mismatchedResponses++;
+    ESP_LOGW(BRIDGE_TAG, "Response %x (command %x) does not match the pending request.", pkt.getPacketType(),
+             pkt.getCommand());
+  } else {
+    orphanedResponses++;
+    ESP_LOGD(BRIDGE_TAG, "Unsolicited response %x (command %x).", pkt.getPacketType(), pkt.getCommand());
   }
 }
 
 // The thermostat bridge loop doesn't expect any responses, so packets in queue are just sent without checking if they expect a response
 void ThermostatBridge::loop() {
   // Try to get a packet
-  if (optional<RawPacket> pkt = receiveRawPacket(SourceBridge::thermostat, ControllerAssociation::thermostat)) {
-    ESP_LOGV(BRIDGE_TAG, "Parsing %x thermostat packet", pkt.value().getPacketType());
+  if (FrameHandle frame = receiveRawPacket(SourceBridge::thermostat, ControllerAssociation::thermostat)) {
+    RawPacket &pkt = *frame;
+    ESP_LOGV(BRIDGE_TAG, "Parsing %x thermostat packet", pkt.getPacketType());
     // Check the packet's checksum and either process it, or log an error
-    if (pkt.value().isChecksumValid()) {
-      classifyAndProcessRawPacket(pkt.value());
+    if (pkt.isChecksumValid()) {
+      pkt.setResponseExpected(isResponseExpected(pkt));
+      pkt_processor.cutThrough(frame);
+      classifyAndProcessRawPacket(frame);
     } else {
-      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s", format_hex_pretty(&pkt.value().getBytes()[0], pkt.value().getLength()).c_str());
+      countStat(BridgeStat::checksum_failures);
+      ESP_LOGW(BRIDGE_TAG, "Invalid packet checksum!\n%s", format_hex_pretty(&pkt.getBytes()[0], pkt.getLength()).c_str());
     }
   } else if (!pkt_queue.empty()) {
     // If there's a packet in the queue...
+    const uint32_t now = millis();
 
-    ESP_LOGV(BRIDGE_TAG, "Sending to thermostat %s", pkt_queue.front().to_string().c_str());
-    writeRawPacket(pkt_queue.front().rawPacket());
-    packet_sent_millis = millis();
+    MUART_LOGV_PACKET(BRIDGE_TAG, "Sending to thermostat ", *pkt_queue.lane(0).front().packet);
+    writeRawPacket(*pkt_queue.lane(0).front().packet);
 
     // Remove packet from queue
-    pkt_queue.pop();
+    pkt_queue.pop(0, now);
   }
 }
 
-/* Queues a packet to be sent by the bridge.  If the queue is full, the packet will not be
-enqueued.*/
-void MUARTBridge::sendPacket(const Packet &packetToSend) {
-  if (pkt_queue.size() <= MAX_QUEUE_SIZE) {
-    pkt_queue.push(packetToSend) ;
-  } else {
-    ESP_LOGW(BRIDGE_TAG, "Packet queue full!  %x packet not sent.", packetToSend.getPacketType());
+// Determines which priority lane a packet bound for the heatpump should wait in
+PacketPriority HeatpumpBridge::classifyPriority(const RawPacket &pkt) {
+  if (pkt.isForwarded()) {
+    return PacketPriority::cut_through;
+  }
+  if (pkt.getControllerAssociation() == ControllerAssociation::thermostat) {
+    return PacketPriority::thermostat;
   }
+  if (pkt.getPacketType() == static_cast<uint8_t>(PacketType::set_request)) {
+    if (pkt.getCommand() == static_cast<uint8_t>(SetCommand::remote_temperature)) {
+      return PacketPriority::remote_temperature;
+    }
+    return PacketPriority::control;
+  }
+  return PacketPriority::poll;
+}
+
+bool HeatpumpBridge::enqueue(const QueuedPacket &queued) {
+  if (coalesce(queued)) return true;
+  return pkt_queue.push(static_cast<size_t>(classifyPriority(*queued.packet)), queued);
+}
+
+bool HeatpumpBridge::isRequestPending(const PacketType type, const uint8_t command) const {
+  auto matches = [type, command](const RawPacket &pkt) {
+    return pkt.getPacketType() == static_cast<uint8_t>(type) && pkt.getCommand() == command;
+  };
+
+  if (transactions.hasLive(static_cast<uint8_t>(type), command)) return true;
+
+  for (size_t l = 0; l < static_cast<size_t>(PacketPriority::count); l++) {
+    const auto &lane = pkt_queue.lane(l);
+    for (size_t i = 0; i < lane.size(); i++) {
+      if (matches(*lane.at(i).packet)) return true;
+    }
+  }
+  return false;
+}
+
+// Only MUART's own settings changes are merged; thermostat packets are forwarded as-is
+bool HeatpumpBridge::isCoalescable(const RawPacket &pkt) {
+  return pkt.getControllerAssociation() == ControllerAssociation::muart &&
+         pkt.getPacketType() == static_cast<uint8_t>(PacketType::set_request) &&
+         pkt.getCommand() == static_cast<uint8_t>(SetCommand::settings);
+}
+
+/* If a settings set request is already waiting to be sent, merges the new request into it rather than
+queueing a second frame (e.g. when a setpoint slider is dragged).  The merged packet keeps its place in
+the queue.  Returns true if the packet was merged.*/
+bool HeatpumpBridge::coalesce(const QueuedPacket &queued) {
+  if (!isCoalescable(*queued.packet)) return false;
+
+  auto &lane = pkt_queue.lane(static_cast<size_t>(PacketPriority::control));
+  for (size_t i = 0; i < lane.size(); i++) {
+    QueuedPacket &pending = lane.at(i);
+    if (!isCoalescable(*pending.packet)) continue;
+
+    // Merge in place, unless someone else still holds the queued frame
+    if (!pending.packet.unique()) {
+      FrameHandle copy = framePool().acquire(*pending.packet);
+      // The overflow frame can't wait in the queue, so with the pool exhausted the new request is queued on its own
+      if (copy.isOverflow()) return false;
+      pending.packet = copy;
+    }
+    SettingsSetRequestPacket merged(pending.packet);
+    merged.mergeFrom(SettingsSetRequestPacket(queued.packet));
+    pending.packet->finalize();
+    coalescedCount++;
+    MUART_LOGV_PACKET(BRIDGE_TAG, "Merged settings request into queued packet ", *pending.packet);
+    return true;
+  }
+  return false;
+}
+
+bool ThermostatBridge::enqueue(const QueuedPacket &queued) {
+  return pkt_queue.push(0, queued);
+}
+
+static const char *PRIORITY_NAMES[] = {"Cut-through", "Control", "Remote Temperature", "Thermostat", "Poll"};
+
+// Requests whose round trip times are tracked separately, in RoundTripCommand order; anything else is "Other"
+struct RoundTripMatch {
+  PacketType type;
+  uint8_t command;
+  const char *name;
+};
+static const RoundTripMatch ROUND_TRIP_COMMANDS[ROUND_TRIP_COMMAND_COUNT - 1] = {
+    {PacketType::connect_request, 0, "Connect"},
+    {PacketType::extended_connect_request, 0, "Extended Connect"},
+    {PacketType::get_request, static_cast<uint8_t>(GetCommand::settings), "Get Settings"},
+    {PacketType::get_request, static_cast<uint8_t>(GetCommand::current_temp), "Get Current Temp"},
+    {PacketType::get_request, static_cast<uint8_t>(GetCommand::error_info), "Get Error Info"},
+    {PacketType::get_request, static_cast<uint8_t>(GetCommand::status), "Get Status"},
+    {PacketType::get_request, static_cast<uint8_t>(GetCommand::standby), "Get Standby"},
+    {PacketType::set_request, static_cast<uint8_t>(SetCommand::settings), "Set Settings"},
+    {PacketType::set_request, static_cast<uint8_t>(SetCommand::remote_temperature), "Set Remote Temp"},
+};
+
+void HeatpumpBridge::recordRoundTrip(const RawPacket &request, const uint32_t roundTripMillis) {
+  roundTripAll.record(roundTripMillis);
+
+  const bool hasCommand = request.getPacketType() == static_cast<uint8_t>(PacketType::get_request) ||
+                          request.getPacketType() == static_cast<uint8_t>(PacketType::set_request);
+  size_t i = 0;
+  for (; i < ROUND_TRIP_COMMAND_COUNT - 1; i++) {
+    const RoundTripMatch &rtc = ROUND_TRIP_COMMANDS[i];
+    if (static_cast<uint8_t>(rtc.type) == request.getPacketType() && (!hasCommand || rtc.command == request.getCommand())) {
+      break;
+    }
+  }
+  roundTripByCommand[i].record(roundTripMillis);
+}
+
+void MUARTBridge::dumpBridgeStats(const char *name) const {
+  ESP_LOGCONFIG(BRIDGE_TAG, "%s frames: %u received, %u sent; %u bytes discarded, %u checksum failures", name,
+                getStat(BridgeStat::frames_received), getStat(BridgeStat::frames_sent),
+                getStat(BridgeStat::bytes_discarded), getStat(BridgeStat::checksum_failures));
+  ESP_LOGCONFIG(BRIDGE_TAG, "%s queue: %u dropped, high water %u", name, getStat(BridgeStat::queue_drops),
+                getStat(BridgeStat::queue_high_water));
+  ESP_LOGCONFIG(BRIDGE_TAG, "%s receive: %u calls hit the per-loop limit, longest call %uus", name,
+                getStat(BridgeStat::receive_limit_hits), getStat(BridgeStat::receive_max_micros));
 }
 
-void MUARTBridge::writeRawPacket(const RawPacket &packetToSend) const {
+void HeatpumpBridge::dumpStats() const {
+  dumpBridgeStats("Heatpump");
+  ESP_LOGCONFIG(BRIDGE_TAG, "Heatpump settings requests merged: %u", coalescedCount);
+  ESP_LOGCONFIG(BRIDGE_TAG, "Heatpump responses: %u late, %u mismatched, %u unsolicited", lateResponses,
+                mismatchedResponses, orphanedResponses);
+  ESP_LOGCONFIG(BRIDGE_TAG, "Heatpump response time: %ums smoothed, %ums timeout; %u retries, %u timeouts",
+                responseTime.getSmoothedRtt(), responseTime.getTimeout(), retriedRequests, getStat(BridgeStat::timeouts));
+  ESP_LOGCONFIG(BRIDGE_TAG, "Heatpump round trip times (p50/p95/max):");
+  for (size_t i = 0; i < ROUND_TRIP_COMMAND_COUNT; i++) {
+    const LatencyHistogram &histogram = roundTripByCommand[i];
+    if (histogram.count() == 0) continue;
+    ESP_LOGCONFIG(BRIDGE_TAG, "  %s: %ums/%ums/%ums (%u samples)",
+                  i < ROUND_TRIP_COMMAND_COUNT - 1 ? ROUND_TRIP_COMMANDS[i].name : "Other", histogram.percentile(0.5f),
+                  histogram.percentile(0.95f), histogram.max(), histogram.count());
+  }
+  ESP_LOGCONFIG(BRIDGE_TAG, "Heatpump queue wait times:");
+  for (size_t i = 0; i < static_cast<size_t>(PacketPriority::count); i++) {
+    const QueueWaitStats &stats = pkt_queue.waitStats(i);
+    ESP_LOGCONFIG(BRIDGE_TAG, "  %s: %u sent, avg %ums, max %ums", PRIORITY_NAMES[i], stats.count,
+                  stats.averageMillis(), stats.maxMillis);
+  }
+}
+
+void ThermostatBridge::dumpStats() const {
+  dumpBridgeStats("Thermostat");
+  const QueueWaitStats &stats = pkt_queue.waitStats(0);
+  ESP_LOGCONFIG(BRIDGE_TAG, "Thermostat queue wait times: %u sent, avg %ums, max %ums", stats.count,
+                stats.averageMillis(), stats.maxMillis);
+}
+
+/* Queues a packet to be sent by the bridge.  Only a handle to the packet's frame is stored, in a fixed-size ring, so
+this neither allocates nor copies the frame.  Heatpump packets are queued by priority (see HeatpumpBridge::classifyPriority).  If the queue is full, the packet will not be enqueued and false is returned.*/
+bool MUARTBridge::sendPacket(const Packet &packetToSend) {
+  return enqueueFrame(packetToSend.frame(), packetToSend.isResponseExpected());
+}
+
+/* Queues a frame read by the other bridge without it having been decoded first (cut-through forwarding).
+The frame must already be marked as forwarded; the heatpump bridge sends these ahead of everything else.*/
+bool MUARTBridge::forwardFrame(const FrameHandle &frame) {
+  return enqueueFrame(frame, isResponseExpected(*frame));
+}
+
+bool MUARTBridge::enqueueFrame(const FrameHandle &frame, bool responseExpected) {
+  // The pool's overflow frame will be overwritten by the next frame acquired, so it can't wait in a queue
+  if (frame.isOverflow()) {
+    countStat(BridgeStat::queue_drops);
+    ESP_LOGW(BRIDGE_TAG, "Frame pool exhausted!  %x packet not sent.", frame->getPacketType());
+    return false;
+  }
+  // Built packets get their (single) checksum calculation here
+  frame->finalize();
+  if (!enqueue(QueuedPacket{frame, responseExpected, millis()})) {
+    countStat(BridgeStat::queue_drops);
+    ESP_LOGW(BRIDGE_TAG, "Packet queue full!  %x packet not sent.", frame->getPacketType());
+    return false;
+  }
+
+  uint32_t &highWater = stats[static_cast<size_t>(BridgeStat::queue_high_water)];
+  if (queuedCount() > highWater) highWater = queuedCount();
+  return true;
+}
+
+// Writes a packet to the UART and records when it was sent
+void MUARTBridge::writeRawPacket(const RawPacket &packetToSend) {
   uart_comp.write_array(packetToSend.getBytes(), packetToSend.getLength());
+  packet_sent_millis = millis();
+  countStat(BridgeStat::frames_sent);
+  if (flight_recorder) flight_recorder->record(packetToSend, getLink(), true, micros());
 }
 
 /* Reads and deserializes a packet from UART.
-Communication with heatpump is *slow*, so we need to check and make sure there are
-enough packets available before we start reading.  If there aren't enough packets,
-no packet will be returned.
-
-Even at 2400 baud, the 100ms readtimeout should be enough to read a whole payload
-after the first byte has been received though, so currently we're assuming that once
-the header is available, it's safe to call read_array without timing out and severing
-the packet.
+Communication with heatpump is *slow*, so rather than waiting for a whole packet to arrive, this only
+consumes bytes that are already available and keeps the partially received frame between calls.  Once
+a complete frame has been assembled it is built directly in a frame pool slot and a handle to it is
+returned, otherwise an empty handle is returned and parsing resumes on the next call.
+
+No more than MAX_BYTES_PER_LOOP bytes, or MAX_RECEIVE_MICROS_PER_LOOP, are spent per call so a line full
+of garbage can't stall the main loop; whatever is left is read on the next call.  A frame can never grow
+past PACKET_MAX_SIZE: the payload length is validated as soon as the header is complete, and the parser
+only ever reads up to the expected length (host/fuzz exercises this with arbitrary input).
 */
-const optional<RawPacket> MUARTBridge::receiveRawPacket(const SourceBridge source_bridge, const ControllerAssociation controller_association) const {
+FrameHandle MUARTBridge::receiveRawPacket(const SourceBridge source_bridge, const ControllerAssociation controller_association) {
   // TODO: Can we make the source_bridge and controller_association inherent to the class instead of passed as arguments?
-  uint8_t packetBytes[PACKET_MAX_SIZE];
-  packetBytes[0] = 0;  // Reset control byte before starting
-
-  // Drain UART until we see a control byte (times out after 100ms in UARTComponent)
-  while (uart_comp.available() >= PACKET_HEADER_SIZE && uart_comp.read_byte(&packetBytes[0])) {
-    if (packetBytes[0] == BYTE_CONTROL) break;
-    // TODO: If the serial is all garbage, this may never stop-- we should have our own timeout
-  }
-
-  // If we never found a control byte, we didn't receive a packet
-  if (packetBytes[0] != BYTE_CONTROL) {
-    return nullopt;
-  }
-
-  // Read the header
-  uart_comp.read_array(&packetBytes[1], PACKET_HEADER_SIZE - 1);
-
-  // Read payload + checksum
-  uint8_t payloadSize = packetBytes[PACKET_HEADER_INDEX_PAYLOAD_LENGTH];
-  uart_comp.read_array(&packetBytes[PACKET_HEADER_SIZE], payloadSize + 1);
-
-  return RawPacket(packetBytes, PACKET_HEADER_SIZE + payloadSize + 1, source_bridge, controller_association);
-}
-
-template <class P>
-void MUARTBridge::processRawPacket(RawPacket &pkt, bool expectResponse) const {
-  P packet = P(std::move(pkt));
-  packet.setResponseExpected(expectResponse);
-  pkt_processor.processPacket(packet);
-}
-
-void MUARTBridge::classifyAndProcessRawPacket(RawPacket &pkt) const {
-  // Figure out how to do this without a static_cast?
-  switch (static_cast<PacketType>(pkt.getPacketType()))
-  {
-  case PacketType::connect_request :
-    processRawPacket<ConnectRequestPacket>(pkt, true);
-    break;
-  case PacketType::connect_response :
-    processRawPacket<ConnectResponsePacket>(pkt, false);
-    break;
-
-  case PacketType::extended_connect_request :
-    processRawPacket<ExtendedConnectRequestPacket>(pkt, true);
-    break;
-  case PacketType::extended_connect_response :
-    processRawPacket<ExtendedConnectResponsePacket>(pkt, false);
-    break;
-
-  case PacketType::get_request :
-    processRawPacket<GetRequestPacket>(pkt, true);
-    break;
-  case PacketType::get_response :
-    switch(static_cast<GetCommand>(pkt.getCommand())) {
-      case GetCommand::settings :
-        processRawPacket<SettingsGetResponsePacket>(pkt, false);
-        break;
-      case GetCommand::current_temp :
-        processRawPacket<CurrentTempGetResponsePacket>(pkt, false);
-        break;
-      case GetCommand::error_info :
-        processRawPacket<ErrorStateGetResponsePacket>(pkt, false);
-        break;
-      case GetCommand::standby :
-        processRawPacket<StandbyGetResponsePacket>(pkt, false);
-        break;
-      case GetCommand::status :
-        processRawPacket<StatusGetResponsePacket>(pkt, false);
-        break;
-      case GetCommand::a_9 :
-        processRawPacket<A9GetRequestPacket>(pkt, false);
-        break;
-      default:
-        processRawPacket<Packet>(pkt, false);
+  const uint32_t started = micros();
+  FrameHandle received = receiveBytes(source_bridge, controller_association, started);
+
+  const uint32_t elapsed = micros() - started;
+  uint32_t &longest = stats[static_cast<size_t>(BridgeStat::receive_max_micros)];
+  if (elapsed > longest) longest = elapsed;
+  return received;
+}
+
+FrameHandle MUARTBridge::receiveBytes(const SourceBridge source_bridge,
+                                      const ControllerAssociation controller_association, const uint32_t started) {
+  // The header check below caps the expected length at PACKET_MAX_SIZE, which rxBytes must be able to hold
+  static_assert(sizeof(rxBytes) >= PACKET_MAX_SIZE, "rxBytes must hold the largest frame the header check accepts");
+  uint8_t byte;
+  for (size_t consumed = 0; uart_comp.available() > 0; consumed++) {
+    if (consumed == MAX_BYTES_PER_LOOP || micros() - started > MAX_RECEIVE_MICROS_PER_LOOP) {
+      countStat(BridgeStat::receive_limit_hits);
+      break;
     }
-    break;
-  case PacketType::set_request :
-    switch(static_cast<SetCommand>(pkt.getCommand())) {
-      case SetCommand::remote_temperature :
-        processRawPacket<RemoteTemperatureSetRequestPacket>(pkt, true);
+    if (!uart_comp.read_byte(&byte)) break;
+
+    switch (rxState) {
+      case ReceiveState::hunting:
+        // Drain UART until we see a control byte
+        if (byte == BYTE_CONTROL) {
+          rxBytes[0] = byte;
+          rxLength = 1;
+          rxState = ReceiveState::header;
+        } else {
+          countStat(BridgeStat::bytes_discarded);
+        }
         break;
-      case SetCommand::settings :
-        processRawPacket<SettingsSetRequestPacket>(pkt, true);
+
+      case ReceiveState::header:
+        rxBytes[rxLength++] = byte;
+        if (rxLength == PACKET_HEADER_SIZE) {
+          uint8_t payloadSize = rxBytes[PACKET_HEADER_INDEX_PAYLOAD_LENGTH];
+          // Header + payload + checksum must fit in a packet, otherwise this wasn't a real header
+          if (payloadSize > PACKET_MAX_SIZE - PACKET_HEADER_SIZE - 1) {
+            ESP_LOGW(BRIDGE_TAG, "Invalid payload length %u, resyncing.", payloadSize);
+            resyncReceive();
+            break;
+          }
+          rxExpectedLength = PACKET_HEADER_SIZE + payloadSize + 1;
+          rxState = payloadSize > 0 ? ReceiveState::payload : ReceiveState::checksum;
+        }
         break;
-      case SetCommand::thermostat_hello :
-        processRawPacket<ThermostatHelloRequestPacket>(pkt, false);
+
+      case ReceiveState::payload:
+        rxBytes[rxLength++] = byte;
+        if (rxLength == rxExpectedLength - 1) {
+          rxState = ReceiveState::checksum;
+        }
         break;
-      default:
-        processRawPacket<Packet>(pkt, true);
+
+      case ReceiveState::checksum: {
+        rxBytes[rxLength++] = byte;
+        const uint8_t length = rxLength;
+        resetReceive();
+        countStat(BridgeStat::frames_received);
+        last_receive_micros = micros();
+        FrameHandle received = framePool().emplace(rxBytes, length, source_bridge, controller_association);
+        if (flight_recorder) flight_recorder->record(*received, source_bridge, false, micros());
+        return received;
+      }
     }
-    break;
-  case PacketType::set_response :
-    switch(static_cast<SetCommand>(pkt.getCommand())) {
-      case SetCommand::remote_temperature :
-        processRawPacket<RemoteTemperatureSetResponsePacket>(pkt, false);
-        break;
-      default:
-        processRawPacket<Packet>(pkt, false);
+  }
+
+  return FrameHandle();
+}
+
+void MUARTBridge::resetReceive() {
+  rxLength = 0;
+  rxExpectedLength = 0;
+  rxState = ReceiveState::hunting;
+}
+
+// Discards a bad partial frame, restarting at the next control byte already received (if any)
+void MUARTBridge::resyncReceive() {
+  for (uint8_t i = 1; i < rxLength; i++) {
+    if (rxBytes[i] == BYTE_CONTROL) {
+      countStat(BridgeStat::bytes_discarded, i);
+      rxLength -= i;
+      memmove(rxBytes, &rxBytes[i], rxLength);
+      rxExpectedLength = 0;
+      rxState = ReceiveState::header;
+      return;
     }
-    break;
+  }
+  countStat(BridgeStat::bytes_discarded, rxLength);
+  resetReceive();
+}
+
+// Packet classes by type and command; frames with no handler are processed as a generic Packet
+static constexpr auto PACKET_DISPATCH = makeDispatchTable(
+    MUART_PACKET_HANDLER_ANY(PacketType::connect_request, ConnectRequestPacket, true),
+    MUART_PACKET_HANDLER_ANY(PacketType::connect_response, ConnectResponsePacket, false),
+    MUART_PACKET_HANDLER_ANY(PacketType::extended_connect_request, ExtendedConnectRequestPacket, true),
+    MUART_PACKET_HANDLER_ANY(PacketType::extended_connect_response, ExtendedConnectResponsePacket, false),
+    MUART_PACKET_HANDLER_ANY(PacketType::get_request, GetRequestPacket, true),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::settings, SettingsGetResponsePacket, false),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::current_temp, CurrentTempGetResponsePacket, false),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::error_info, ErrorStateGetResponsePacket, false),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::standby, StandbyGetResponsePacket, false),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::status, StatusGetResponsePacket, false),
+    MUART_PACKET_HANDLER(PacketType::get_response, GetCommand::a_9, A9GetRequestPacket, false),
+    MUART_PACKET_HANDLER_ANY(PacketType::get_response, Packet, false),
+    MUART_PACKET_HANDLER(PacketType::set_request, SetCommand::remote_temperature, RemoteTemperatureSetRequestPacket, true),
+    MUART_PACKET_HANDLER(PacketType::set_request, SetCommand::settings, SettingsSetRequestPacket, true),
+    MUART_PACKET_HANDLER(PacketType::set_request, SetCommand::thermostat_hello, ThermostatHelloRequestPacket, false),
+    MUART_PACKET_HANDLER_ANY(PacketType::set_request, Packet, true),
+    MUART_PACKET_HANDLER(PacketType::set_response, SetCommand::remote_temperature, RemoteTemperatureSetResponsePacket, false),
+    MUART_PACKET_HANDLER_ANY(PacketType::set_response, Packet, false));
+static_assert(!PACKET_DISPATCH.hasDuplicates(), "A packet type and command has more than one handler");
 
-  default:
-    processRawPacket<Packet>(pkt, true); // If we get an unknown packet from the thermostat, expect a response
+bool MUARTBridge::isResponseExpected(const RawPacket &frame) {
+  const PacketHandler *handler = PACKET_DISPATCH.find(frame.getPacketType(), frame.getCommand());
+  return handler ? handler->expectResponse : true;  // Unknown packets from the thermostat are assumed to expect one
+}
+
+void MUARTBridge::classifyAndProcessRawPacket(const FrameHandle &frame) const {
+  if (const PacketHandler *handler = PACKET_DISPATCH.find(frame->getPacketType(), frame->getCommand())) {
+    handler->dispatch(frame, pkt_processor);
+  } else {
+    dispatchPacket<Packet>(frame, pkt_processor);
   }
 }
 
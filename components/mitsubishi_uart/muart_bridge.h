@@ -2,47 +2,191 @@
 
 #include "esphome/components/uart/uart.h"
 #include "muart_packet.h"
-#include "queue"
+#include "muart_dispatch.h"
+#include "muart_flightrecorder.h"
+#include "muart_histogram.h"
+#include "muart_packetqueue.h"
+#include "muart_transactions.h"
 
 namespace esphome {
 namespace mitsubishi_uart {
 
 static const char *BRIDGE_TAG = "muart_bridge";
-static const uint32_t RESPONSE_TIMEOUT_MS = 3000; // Maximum amount of time to wait for an expected response packet
+static const uint32_t LATE_RESPONSE_GRACE_MS = 3000; // Time after a timeout during which a late response is still matched
 /* Maximum number of packets allowed to be queued for sending.  In some circumstances the equipment response
 time can be very slow and packets would queue up faster than they were being received.  TODO: Not sure what size this should
-be, 4ish should be enough for almost all situations, so 8 seems plenty.*/
+be, 4ish should be enough for almost all situations, so 8 seems plenty.  This applies per priority lane.*/
 static const size_t MAX_QUEUE_SIZE = 8;
+// Packets that have waited this long are sent ahead of higher priority packets, so polling can't be starved
+static const uint32_t QUEUE_STARVATION_TIMEOUT_MS = 10000;
+/* Maximum number of bytes consumed from the UART in a single call to receiveRawPacket.  At 2400 baud only ~4 bytes
+arrive between loop() calls, so this is plenty to keep up while still bounding the work done on a noisy line.*/
+static const size_t MAX_BYTES_PER_LOOP = PACKET_MAX_SIZE * 2;
+/* Time limit for a single call to receiveRawPacket.  Reading already-buffered bytes takes a few microseconds each, so
+this only comes into play if reading stalls (e.g. a slow UART driver), and keeps loop() latency bounded either way.*/
+static const uint32_t MAX_RECEIVE_MICROS_PER_LOOP = 1000;
+
+// States of the incremental receive parser
+enum class ReceiveState : uint8_t {
+  hunting,  // Discarding bytes until a BYTE_CONTROL is seen
+  header,   // Reading the remainder of the header
+  payload,  // Reading the payload
+  checksum  // Reading the final checksum byte
+};
+
+// Send priority of packets queued for the heatpump, highest priority first
+enum class PacketPriority : uint8_t {
+  cut_through,         // Thermostat frames forwarded before they've been decoded
+  control,             // Settings changes (and other set requests) from MUART
+  remote_temperature,  // Remote temperature updates
+  thermostat,          // Packets proxied on behalf of the thermostat
+  poll,                // Connection and get requests used for polling
+  count
+};
+
+// Number of times a request is retried after timing out, by PacketPriority.  Thermostat requests are retried by the
+// thermostat itself, and a missed poll will just be sent again on its next interval.
+static const uint8_t MAX_RETRIES[] = {0, 3, 2, 0, 0};
+/* A request isn't retried if waiting for the retry would take it past this long since it was first sent.  Nothing
+else can be sent while a request is waiting, so this bounds how long one unanswered request can hold up the bus.*/
+static const uint32_t MAX_RETRY_WINDOW_MS = 6000;
+
+// Request types with their own round trip histogram, and one for all other requests
+enum class RoundTripCommand : uint8_t {
+  connect,
+  extended_connect,
+  get_settings,
+  get_current_temp,
+  get_error_info,
+  get_status,
+  get_standby,
+  set_settings,
+  set_remote_temp,
+  other,
+  count
+};
+static const size_t ROUND_TRIP_COMMAND_COUNT = static_cast<size_t>(RoundTripCommand::count);
+
+// Health counters kept by each bridge (see MUARTBridge::getStat)
+enum class BridgeStat : uint8_t {
+  frames_received,
+  frames_sent,
+  bytes_discarded,    // Bytes thrown away while looking for the start of a packet
+  checksum_failures,
+  timeouts,           // Requests that never received a response
+  queue_drops,        // Packets not sent because the queue was full
+  queue_high_water,   // Most packets ever waiting in the queue at once
+  receive_limit_hits,  // Calls to receiveRawPacket that stopped at MAX_BYTES_PER_LOOP or MAX_RECEIVE_MICROS_PER_LOOP
+  receive_max_micros,  // Longest time spent in a single call to receiveRawPacket
+  count
+};
 
 // A UARTComponent wrapper to send and receieve packets
 class MUARTBridge  {
   public:
     MUARTBridge(uart::UARTComponent *uart_component, PacketProcessor *packet_processor);
 
-    // Enqueues a packet to be sent
-    void sendPacket(const Packet &packetToSend);
+    // Enqueues a packet to be sent.  Returns false if the queue was full and the packet was dropped.
+    bool sendPacket(const Packet &packetToSend);
+    // Enqueues a frame received by the other bridge as-is (sharing it, not copying it), ahead of other packets
+    bool forwardFrame(const FrameHandle &frame);
+
+    // When the most recent complete frame was received
+    uint32_t getLastReceiveMicros() const { return last_receive_micros; }
 
     // Checks for incoming packets, processes them, sends queued packets
     virtual void loop() = 0;
 
+    // Logs queue and response statistics (used by dump_config)
+    virtual void dumpStats() const = 0;
+
+    uint32_t getStat(BridgeStat stat) const { return stats[static_cast<size_t>(stat)]; }
+
+    // Frames sent and received by this bridge will be copied into the recorder (if set)
+    void setFlightRecorder(FlightRecorder *recorder) { flight_recorder = recorder; }
+
   protected:
-    const optional<RawPacket> receiveRawPacket(const SourceBridge source_bridge, const ControllerAssociation controller_association) const;
-    void writeRawPacket(const RawPacket &pkt) const;
-    template <class P>
-    void processRawPacket(RawPacket &pkt, bool expectResponse = true) const;
-    void classifyAndProcessRawPacket(RawPacket &pkt) const;
+    // Returns the next complete frame (in a pool slot), or an empty handle if one hasn't been received yet
+    FrameHandle receiveRawPacket(const SourceBridge source_bridge, const ControllerAssociation controller_association);
+    void writeRawPacket(const RawPacket &pkt);
+    void classifyAndProcessRawPacket(const FrameHandle &frame) const;
+    // Whether the frame's registered packet class expects a response (see PACKET_DISPATCH)
+    static bool isResponseExpected(const RawPacket &frame);
+    // Adds a packet to this bridge's queue.  Returns false if there was no room.
+    virtual bool enqueue(const QueuedPacket &queued) = 0;
+    // Number of packets currently in this bridge's queue
+    virtual size_t queuedCount() const = 0;
+    // Which equipment this bridge is connected to
+    virtual SourceBridge getLink() const = 0;
+
+    void countStat(BridgeStat stat, uint32_t amount = 1) { stats[static_cast<size_t>(stat)] += amount; }
+    bool enqueueFrame(const FrameHandle &frame, bool responseExpected);
+    void dumpBridgeStats(const char *name) const;
 
     uart::UARTComponent &uart_comp;
     PacketProcessor &pkt_processor;
-    std::queue<Packet> pkt_queue;
-    optional<Packet> packetAwaitingResponse = nullopt;
+    FlightRecorder *flight_recorder = nullptr;
     uint32_t packet_sent_millis;
+    uint32_t last_receive_micros = 0;
+
+  private:
+    FrameHandle receiveBytes(SourceBridge source_bridge, ControllerAssociation controller_association,
+                             uint32_t started);
+    void resetReceive();
+    void resyncReceive();
+
+    uint32_t stats[static_cast<size_t>(BridgeStat::count)]{};
+
+    // Partially received frame, kept between calls to receiveRawPacket
+    uint8_t rxBytes[PACKET_MAX_SIZE];
+    uint8_t rxLength = 0;
+    uint8_t rxExpectedLength = 0;
+    ReceiveState rxState = ReceiveState::hunting;
 };
 
 class HeatpumpBridge : public MUARTBridge{
   public:
   using MUARTBridge::MUARTBridge;
   void loop() override;
+  void dumpStats() const override;
+
+  // Number of settings set requests that were merged into an already queued request
+  uint32_t getCoalescedCount() const { return coalescedCount; }
+
+  // Returns true if a packet of this type and command is queued or waiting for a response
+  bool isRequestPending(PacketType type, uint8_t command) const;
+
+  // Round trip times of all requests
+  const LatencyHistogram &getRoundTripHistogram() const { return roundTripAll; }
+  // Round trip times of one type of request
+  const LatencyHistogram &getRoundTripHistogram(RoundTripCommand command) const {
+    return roundTripByCommand[static_cast<size_t>(command)];
+  }
+
+  protected:
+  bool enqueue(const QueuedPacket &queued) override;
+  size_t queuedCount() const override { return pkt_queue.size(); }
+  SourceBridge getLink() const override { return SourceBridge::heatpump; }
+
+  private:
+  static PacketPriority classifyPriority(const RawPacket &pkt);
+  static bool isCoalescable(const RawPacket &pkt);
+  bool coalesce(const QueuedPacket &queued);
+  void correlateResponse(RawPacket &pkt);
+  void recordRoundTrip(const RawPacket &request, uint32_t roundTripMillis);
+
+  TransactionTable transactions{LATE_RESPONSE_GRACE_MS};
+  ResponseTimeEstimator responseTime;
+  LatencyHistogram roundTripAll;
+  LatencyHistogram roundTripByCommand[ROUND_TRIP_COMMAND_COUNT];
+
+  uint32_t coalescedCount = 0;
+  uint32_t lateResponses = 0;        // Responses matched to a request that had already timed out
+  uint32_t mismatchedResponses = 0;  // Responses that arrived while waiting, but didn't match the request
+  uint32_t orphanedResponses = 0;    // Responses that arrived when no request was outstanding
+  uint32_t retriedRequests = 0;
+
+  PacketQueue<static_cast<size_t>(PacketPriority::count), MAX_QUEUE_SIZE> pkt_queue{QUEUE_STARVATION_TIMEOUT_MS};
 };
 
 class ThermostatBridge : public MUARTBridge{
@@ -50,6 +194,16 @@ class ThermostatBridge : public MUARTBridge{
   using MUARTBridge::MUARTBridge;
   //ThermostatBridge(uart::UARTComponent &uart_component, PacketProcessor &packet_processor) : MUARTBridge(uart_component, packet_processor){};
   void loop() override;
+  void dumpStats() const override;
+
+  protected:
+  bool enqueue(const QueuedPacket &queued) override;
+  size_t queuedCount() const override { return pkt_queue.size(); }
+  SourceBridge getLink() const override { return SourceBridge::thermostat; }
+
+  private:
+  // The thermostat doesn't need any prioritization, so there's just a single lane
+  PacketQueue<1, MAX_QUEUE_SIZE> pkt_queue{QUEUE_STARVATION_TIMEOUT_MS};
 };
 
 }  // namespace mitsubishi_uart
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <utility>
+#include "muart_packet.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+/* Decodes a raw frame as packet class P and hands it to the processor.  The frame may already be shared (queued by
+cut-through, or in the response cache), so decoding never writes to it; whether it expects a response is set by the
+bridge when it's received (see MUARTBridge::isResponseExpected).*/
+template<class P> void dispatchPacket(const FrameHandle &frame, PacketProcessor &processor) {
+  processor.processPacket(P(frame));
+}
+
+// How to decode frames of one packet type and command
+struct PacketHandler {
+  uint8_t type;
+  uint8_t command;
+  bool anyCommand;  // Handles every command of this type that doesn't have its own handler
+  bool expectResponse;
+  void (*dispatch)(const FrameHandle &frame, PacketProcessor &processor);
+};
+
+// Registers a packet class for a (type, command) pair.  Adding a packet class only needs one of these lines.
+#define MUART_PACKET_HANDLER(packet_type, packet_command, packet_class, expect_response) \
+  PacketHandler { \
+    static_cast<uint8_t>(packet_type), static_cast<uint8_t>(packet_command), false, expect_response, \
+        &dispatchPacket<packet_class> \
+  }
+// Registers a packet class for every command of a type that isn't otherwise registered
+#define MUART_PACKET_HANDLER_ANY(packet_type, packet_class, expect_response) \
+  PacketHandler { static_cast<uint8_t>(packet_type), 0, true, expect_response, &dispatchPacket<packet_class> }
+
+/* A hash table of packet handlers keyed on (type, command), built at compile time, so finding the handler for a frame
+takes the same time however many packet classes are registered.  Lookups first try the exact command, then any
+catch-all handler for the type.
+*/
+template<size_t N> class PacketDispatchTable {
+ public:
+  static constexpr size_t SLOTS = 64;  // Power of two, kept at least twice the number of handlers
+  static_assert(N * 2 <= SLOTS && N < 0xff, "Too many packet handlers for the dispatch table, increase SLOTS");
+
+  constexpr explicit PacketDispatchTable(const std::array<PacketHandler, N> &packet_handlers)
+      : handlers{packet_handlers} {
+    for (size_t s = 0; s < SLOTS; s++) slots[s] = EMPTY;
+    for (size_t i = 0; i < N; i++) {
+      const uint32_t key = keyOf(handlers[i].type, handlers[i].command, handlers[i].anyCommand);
+      size_t s = slotOf(key);
+      while (slots[s] != EMPTY) {
+        const PacketHandler &other = handlers[slots[s]];
+        if (keyOf(other.type, other.command, other.anyCommand) == key) duplicates = true;
+        s = (s + 1) % SLOTS;
+      }
+      slots[s] = i;
+    }
+  }
+
+  // True if two handlers were registered for the same key (checked with a static_assert where the table is defined)
+  constexpr bool hasDuplicates() const { return duplicates; }
+
+  // Handler for the frame, or nullptr if nothing is registered for it
+  const PacketHandler *find(uint8_t type, uint8_t command) const {
+    if (const PacketHandler *handler = probe(keyOf(type, command, false))) return handler;
+    return probe(keyOf(type, 0, true));
+  }
+
+ private:
+  static constexpr uint8_t EMPTY = 0xff;
+
+  static constexpr uint32_t keyOf(uint8_t type, uint8_t command, bool anyCommand) {
+    return anyCommand ? 0x10000 | type << 8 : type << 8 | command;
+  }
+  // Fibonacci hashing, keeping the top 6 bits (log2 of SLOTS)
+  static constexpr size_t slotOf(uint32_t key) { return static_cast<uint32_t>(key * 2654435769u) >> 26; }
+
+  const PacketHandler *probe(uint32_t key) const {
+    for (size_t s = slotOf(key); slots[s] != EMPTY; s = (s + 1) % SLOTS) {
+      const PacketHandler &handler = handlers[slots[s]];
+      if (keyOf(handler.type, handler.command, handler.anyCommand) == key) return &handler;
+    }
+    return nullptr;
+  }
+
+  std::array<PacketHandler, N> handlers;
+  std::array<uint8_t, SLOTS> slots{};
+  bool duplicates = false;
+};
+
+template<typename... H> constexpr PacketDispatchTable<sizeof...(H)> makeDispatchTable(H... handlers) {
+  return PacketDispatchTable<sizeof...(H)>(std::array<PacketHandler, sizeof...(H)>{{handlers...}});
+}
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "muart_rawpacket.h"
+#include "muart_ringbuffer.h"
+#include <cstring>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+static constexpr const char *FLIGHT_RECORDER_TAG = "mitsubishi_uart.flight_recorder";
+
+// Number of frames kept by the flight recorder
+static const size_t FLIGHT_RECORDER_SIZE = 32;
+
+// A single frame in the flight recorder
+struct FlightRecord {
+  /* Packed metadata:
+  bits 0-1: SourceBridge of the packet
+  bits 2-3: ControllerAssociation of the packet
+  bits 4-5: SourceBridge of the link the frame was seen on
+  bit 7:    set if the frame was sent, clear if it was received
+  */
+  static const uint8_t FLAG_SENT = 0x80;
+
+  uint32_t micros;
+  uint8_t meta;
+  uint8_t length;
+  uint8_t bytes[PACKET_MAX_SIZE];
+};
+
+/* Keeps the last FLIGHT_RECORDER_SIZE frames sent and received by the bridges so that they can be dumped after
+something goes wrong, without needing packet logging enabled beforehand.  Recording is just a copy into a fixed
+ring (no allocation or formatting), so it's cheap enough to leave on all the time.
+
+Frames are dumped one per log line, as base64 of: micros (4 bytes, little endian), meta, length, then the frame bytes.
+*/
+class FlightRecorder {
+ public:
+  void record(const RawPacket &packet, const SourceBridge link, const bool sent, const uint32_t now_micros) {
+    if (records.full()) records.pop();
+
+    FlightRecord entry;
+    entry.micros = now_micros;
+    entry.meta = (static_cast<uint8_t>(packet.getSourceBridge()) & 0x03) |
+                 (static_cast<uint8_t>(packet.getControllerAssociation()) & 0x03) << 2 |
+                 (static_cast<uint8_t>(link) & 0x03) << 4 | (sent ? FlightRecord::FLAG_SENT : 0);
+    entry.length = packet.getLength();
+    memcpy(entry.bytes, packet.getBytes(), entry.length);
+    records.push(entry);
+  }
+
+  size_t size() const { return records.size(); }
+
+  // Access by position, where 0 is the oldest frame
+  const FlightRecord &at(size_t index) const { return records.at(index); }
+
+  void clear() { records.clear(); }
+
+  // Logs every recorded frame, oldest first
+  void dump() const {
+    ESP_LOGCONFIG(FLIGHT_RECORDER_TAG, "Flight recorder: %u frames", static_cast<unsigned>(records.size()));
+
+    uint8_t buffer[sizeof(uint32_t) + 2 + PACKET_MAX_SIZE];
+    for (size_t i = 0; i < records.size(); i++) {
+      const FlightRecord &entry = records.at(i);
+      for (size_t b = 0; b < sizeof(uint32_t); b++) buffer[b] = (entry.micros >> (8 * b)) & 0xff;
+      buffer[4] = entry.meta;
+      buffer[5] = entry.length;
+      memcpy(&buffer[6], entry.bytes, entry.length);
+      ESP_LOGCONFIG(FLIGHT_RECORDER_TAG, "FR%02u %s", static_cast<unsigned>(i), base64_encode(buffer, 6 + entry.length).c_str());
+    }
+  }
+
+ private:
+  RingBuffer<FlightRecord, FLIGHT_RECORDER_SIZE> records;
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
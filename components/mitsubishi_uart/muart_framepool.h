@@ -0,0 +1,155 @@
+#pragma once
+
+#include "esphome/core/log.h"
+#include "muart_rawpacket.h"
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+/* Number of frames that can be alive at once.  Covers the heatpump and thermostat queues being mostly full, the
+outstanding transactions and the response cache.
+*/
+static const size_t FRAME_POOL_SIZE = 48;
+// Slots set aside for frames that live as long as the program (the static request instances, see emplacePinned)
+static const size_t FRAME_POOL_PINNED_SIZE = 8;
+// A slot with this many references stays allocated for good, rather than the count wrapping and freeing it early
+static const uint8_t FRAME_REFS_SATURATED = UINT8_MAX;
+
+// A pool slot: the frame itself, plus the number of handles referring to it
+struct FrameSlot {
+  RawPacket frame;
+  uint8_t refs = 0;
+  bool overflow = false;  // The shared slot handed out when the pool is exhausted (never counted or freed)
+};
+
+/* A counted reference to a frame in the FramePool.  Copying a handle shares the frame rather than copying its bytes;
+the slot is returned to the pool when the last handle is destroyed.  A default-constructed handle refers to nothing.
+*/
+class FrameHandle {
+ public:
+  FrameHandle() = default;
+  explicit FrameHandle(FrameSlot *slot) : slot_{slot} { retain(); }
+  FrameHandle(const FrameHandle &other) : slot_{other.slot_} { retain(); }
+  FrameHandle(FrameHandle &&other) : slot_{other.slot_} { other.slot_ = nullptr; }
+  ~FrameHandle() { release(); }
+
+  FrameHandle &operator=(const FrameHandle &other) {
+    if (slot_ != other.slot_) {
+      release();
+      slot_ = other.slot_;
+      retain();
+    }
+    return *this;
+  }
+  FrameHandle &operator=(FrameHandle &&other) {
+    if (this != &other) {
+      release();
+      slot_ = other.slot_;
+      other.slot_ = nullptr;
+    }
+    return *this;
+  }
+
+  explicit operator bool() const { return slot_ != nullptr; }
+  RawPacket &operator*() const { return slot_->frame; }
+  RawPacket *operator->() const { return &slot_->frame; }
+
+  // True if no other handle refers to this frame (so it can be modified without affecting anyone else)
+  bool unique() const { return slot_ != nullptr && slot_->refs == 1; }
+
+  // True if the pool was exhausted and this frame is only valid until the next frame is acquired
+  bool isOverflow() const { return slot_ != nullptr && slot_->overflow; }
+
+ private:
+  void retain() {
+    if (slot_ && !slot_->overflow && slot_->refs != FRAME_REFS_SATURATED) slot_->refs++;
+  }
+  void release() {
+    if (slot_ && !slot_->overflow && slot_->refs != FRAME_REFS_SATURATED) slot_->refs--;
+    slot_ = nullptr;
+  }
+
+  FrameSlot *slot_ = nullptr;
+};
+
+/* Fixed storage for every frame received, built or queued, so that a frame is written once and then passed around
+by handle.  If every slot is in use, the overflow slot is handed out instead; it can be decoded but will be rejected
+by the send queues, since it may be overwritten at any time.  Frames that are never released get pinned slots of their
+own, so they neither hold a pool slot forever nor end up in the overflow slot if they're built while it's in use.
+*/
+class FramePool {
+ public:
+  FramePool() { slots[FRAME_POOL_SIZE].overflow = true; }
+
+  // Copies the frame into a free slot and returns a handle to it
+  FrameHandle acquire(const RawPacket &contents) {
+    FrameSlot *slot = freeSlot();
+    slot->frame = contents;
+    written++;
+    return FrameHandle(slot);
+  }
+
+  // Constructs a frame directly in a free slot (with RawPacket's constructor arguments) and returns a handle to it
+  template<typename... Args> FrameHandle emplace(Args &&...args) {
+    return construct(freeSlot(), std::forward<Args>(args)...);
+  }
+
+  // As emplace(), but in a pinned slot: for frames kept for the life of the program
+  template<typename... Args> FrameHandle emplacePinned(Args &&...args) {
+    if (pinnedUsed == FRAME_POOL_PINNED_SIZE) {
+      ESP_LOGE("mitsubishi_uart.frame_pool", "Out of pinned frame slots, increase FRAME_POOL_PINNED_SIZE");
+      return emplace(std::forward<Args>(args)...);
+    }
+    return construct(&pinned[pinnedUsed++], std::forward<Args>(args)...);
+  }
+
+  size_t inUse() const {
+    size_t used = 0;
+    for (size_t i = 0; i < FRAME_POOL_SIZE; i++) used += slots[i].refs > 0;
+    return used;
+  }
+  // Number of times a frame couldn't be given its own slot
+  uint32_t exhaustedCount() const { return exhausted; }
+  // Number of frames written into the pool; everything else only copies handles, so this counts every frame copy
+  uint32_t writtenCount() const { return written; }
+  size_t pinnedCount() const { return pinnedUsed; }
+
+ private:
+  template<typename... Args> FrameHandle construct(FrameSlot *slot, Args &&...args) {
+    slot->frame.~RawPacket();
+    new (&slot->frame) RawPacket(std::forward<Args>(args)...);
+    written++;
+    return FrameHandle(slot);
+  }
+
+  FrameSlot *freeSlot() {
+    for (size_t i = 0; i < FRAME_POOL_SIZE; i++) {
+      const size_t index = (next + i) % FRAME_POOL_SIZE;
+      if (slots[index].refs == 0) {
+        next = (index + 1) % FRAME_POOL_SIZE;
+        return &slots[index];
+      }
+    }
+    exhausted++;
+    return &slots[FRAME_POOL_SIZE];
+  }
+
+  FrameSlot slots[FRAME_POOL_SIZE + 1];
+  FrameSlot pinned[FRAME_POOL_PINNED_SIZE];
+  size_t pinnedUsed = 0;
+  size_t next = 0;
+  uint32_t exhausted = 0;
+  uint32_t written = 0;
+};
+
+// The pool shared by all packets
+inline FramePool &framePool() {
+  static FramePool pool;
+  return pool;
+}
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+/* A fixed-bucket histogram of latencies in milliseconds.  Memory use is constant regardless of how many samples are
+recorded; if a bucket would overflow, all buckets are halved so the distribution is kept (weighted towards recent
+samples).  Percentiles are interpolated within a bucket, so they're only as precise as the bucket widths.
+*/
+class LatencyHistogram {
+ public:
+  // Upper bound (inclusive) of each bucket; the last bucket holds everything larger
+  static constexpr uint16_t BUCKET_BOUNDS_MS[] = {50, 100, 150, 200, 250, 300, 400, 500, 750, 1000, 1500, 2000, 3000};
+  static constexpr size_t BUCKET_COUNT = sizeof(BUCKET_BOUNDS_MS) / sizeof(BUCKET_BOUNDS_MS[0]) + 1;
+
+  void record(uint32_t latencyMillis) {
+    size_t bucket = 0;
+    while (bucket < BUCKET_COUNT - 1 && latencyMillis > BUCKET_BOUNDS_MS[bucket]) bucket++;
+
+    if (buckets[bucket] == UINT16_MAX) {
+      for (uint16_t &b : buckets) b /= 2;
+    }
+    buckets[bucket]++;
+    if (latencyMillis > maxMillis) maxMillis = latencyMillis;
+  }
+
+  uint32_t count() const {
+    uint32_t total = 0;
+    for (uint16_t b : buckets) total += b;
+    return total;
+  }
+
+  uint32_t max() const { return maxMillis; }
+
+  // Estimated latency below which `fraction` (0-1) of samples fall, or 0 if there are no samples
+  uint32_t percentile(float fraction) const {
+    const uint32_t total = count();
+    if (total == 0) return 0;
+
+    const float target = fraction * total;
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; i++) {
+      if (buckets[i] == 0 || cumulative + buckets[i] < target) {
+        cumulative += buckets[i];
+        continue;
+      }
+      const uint32_t lower = i == 0 ? 0 : BUCKET_BOUNDS_MS[i - 1];
+      const uint32_t upper = i == BUCKET_COUNT - 1 ? maxMillis : BUCKET_BOUNDS_MS[i];
+      const uint32_t estimate = lower + (uint32_t) ((upper - lower) * (target - cumulative) / buckets[i]);
+      return estimate < maxMillis ? estimate : maxMillis;
+    }
+    return maxMillis;
+  }
+
+ private:
+  uint16_t buckets[BUCKET_COUNT]{};
+  uint32_t maxMillis = 0;
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
@@ -5,123 +5,90 @@
 namespace esphome {
 namespace mitsubishi_uart {
 
-// Packet to_strings()
+// Packet formatting
 
-std::string ConnectRequestPacket::to_string() const {
-  return("Connect Request: " + Packet::to_string());
+static const char *yesNo(bool value) { return value ? "Yes" : "No"; }
+
+void ConnectRequestPacket::format(FormatBuffer &out) const {
+  out.printf("Connect Request: ");
+  Packet::format(out);
+}
+void ConnectResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Connect Response: ");
+  Packet::format(out);
 }
-std::string ConnectResponsePacket::to_string() const {
-  return("Connect Response: " + Packet::to_string());
+// Packets with a schema list its fields, plus anything derived from more than one field
+void ExtendedConnectResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Extended Connect Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
+  out.printf(" FanSpeeds:%u", getSupportedFanSpeeds());
 }
-std::string ExtendedConnectResponsePacket::to_string() const {
-  return ("Extended Connect Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n HeatDisabled:" + (isHeatDisabled()?"Yes":"No")
-  + " SupportsVane:" + (supportsVane()?"Yes":"No")
-  + " SupportsVaneSwing:" + (supportsVaneSwing()?"Yes":"No")
-
-  + " DryDisabled:" + (isDryDisabled()?"Yes":"No")
-  + " FanDisabled:" + (isFanDisabled()?"Yes":"No")
-  + " ExtTempRange:" + (hasExtendedTemperatureRange()?"Yes":"No")
-  + " AutoFanDisabled:" + (autoFanSpeedDisabled()?"Yes":"No")
-  + " InstallerSettings:" + (supportsInstallerSettings()?"Yes":"No")
-  + " TestMode:" + (supportsTestMode()?"Yes":"No")
-  + " DryTemp:" + (supportsDryTemperature()?"Yes":"No")
-
-  + " StatusDisplay:" + (hasStatusDisplay()?"Yes":"No")
-
-  + "\n CoolDrySetpoint:" + std::to_string(getMinCoolDrySetpoint()) + "/" + std::to_string(getMaxCoolDrySetpoint())
-  + " HeatSetpoint:" + std::to_string(getMinHeatingSetpoint()) + "/" + std::to_string(getMaxHeatingSetpoint())
-  + " AutoSetpoint:" + std::to_string(getMinAutoSetpoint()) + "/" + std::to_string(getMaxAutoSetpoint())
-  + " FanSpeeds:" + std::to_string(getSupportedFanSpeeds()));
+void CurrentTempGetResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Current Temp Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
 }
-std::string CurrentTempGetResponsePacket::to_string() const {
-  return ("Current Temp Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n Temp:" + std::to_string(getCurrentTemp()));
+void SettingsGetResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Settings Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
 }
-std::string SettingsGetResponsePacket::to_string() const {
-
-  return ("Settings Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n Fan:" + format_hex(getFan())
-  + " Mode:" + format_hex(getMode())
-  + " Power:" + (getPower()==3 ? "Test" : getPower()>0 ? "On" : "Off")
-  + " TargetTemp:" + std::to_string(getTargetTemp())
-  + " Vane:" + format_hex(getVane())
-  + " HVane:" + format_hex(getHorizontalVane())
-  + "\n PowerLock:" + (lockedPower()?"Yes":"No")
-  + " ModeLock:" + (lockedMode()?"Yes":"No")
-  + " TempLock:" + (lockedTemp()?"Yes":"No")
-  );
+void StandbyGetResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Standby Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
+  if (getActualFanSpeed() < ACTUAL_FAN_SPEED_NAMES.size()) {
+    out.printf(" (%s)", ACTUAL_FAN_SPEED_NAMES[getActualFanSpeed()].c_str());
+  }
 }
-std::string StandbyGetResponsePacket::to_string() const {
-  return ("Standby Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n ServiceFilter:" + (serviceFilter()?"Yes":"No")
-  + " Defrost:" + (inDefrost()?"Yes":"No")
-  + " HotAdjust:" + (inHotAdjust()?"Yes":"No")
-  + " Standby:" + (inStandby()?"Yes":"No")
-  + " ActualFan:" + ACTUAL_FAN_SPEED_NAMES[getActualFanSpeed()] + " (" + std::to_string(getActualFanSpeed()) + ")"
-  + " AutoMode:" + format_hex(getAutoMode())
-  );
+void StatusGetResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Status Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
 }
-std::string StatusGetResponsePacket::to_string() const {
-  return ("Status Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n CompressorFrequency: " + std::to_string(getCompressorFrequency())
-  + " Operating: " + (getOperating() ? "Yes":"No")
-  );
+void ErrorStateGetResponsePacket::format(FormatBuffer &out) const {
+  out.printf("Error State Response: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
+  out.printf(" Error State: %s (%s)", yesNo(errorPresent()), getShortCode().c_str());
 }
-std::string ErrorStateGetResponsePacket::to_string() const {
-  return ("Error State Response: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n Error State: " + (errorPresent() ? "Yes" : "No")
-  + " ErrorCode: " + format_hex(getErrorCode())
-  + " ShortCode: " + getShortCode() + "(" + format_hex(getRawShortCode()) + ")"
-  );
+void SettingsSetRequestPacket::format(FormatBuffer &out) const {
+  out.printf("Settings Set Request: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
 }
-std::string RemoteTemperatureSetRequestPacket::to_string() const {
-  return ("Remote Temp Set Request: " + Packet::to_string()
-  + CONSOLE_COLOR_PURPLE
-  + "\n Temp:" + std::to_string(getRemoteTemperature()));
+void RemoteTemperatureSetRequestPacket::format(FormatBuffer &out) const {
+  out.printf("Remote Temp Set Request: ");
+  Packet::format(out);
+  formatFields(out, SCHEMA);
 }
 
-std::string ThermostatHelloRequestPacket::to_string() const {
-  return("Thermostat Hello: " + Packet::to_string() + CONSOLE_COLOR_PURPLE +
-          "\n Model: " + getThermostatModel() +
-          " Serial: " + getThermostatSerial() +
-          " Version: " + getThermostatVersionString());
+void ThermostatHelloRequestPacket::format(FormatBuffer &out) const {
+  out.printf("Thermostat Hello: ");
+  Packet::format(out);
+  out.printf(CONSOLE_COLOR_PURPLE "\n Model: %s Serial: %s Version: %s", getThermostatModel().c_str(),
+             getThermostatSerial().c_str(), getThermostatVersionString().c_str());
 }
 
 // TODO: Are there function implementations for packets in the .h file? (Yes)  Should they be here?
 
 // SettingsSetRequestPacket functions
 
-void SettingsSetRequestPacket::addSettingsFlag(const SETTING_FLAG flagToAdd) {
-  addFlag(flagToAdd);
-}
-
-void SettingsSetRequestPacket::addSettingsFlag2(const SETTING_FLAG2 flag2ToAdd) {
-  addFlag2(flag2ToAdd);
-}
-
 SettingsSetRequestPacket &SettingsSetRequestPacket::setPower(const bool isOn) {
-  pkt_.setPayloadByte(PLINDEX_POWER, isOn ? 0x01 : 0x00);
-  addSettingsFlag(SF_POWER);
+  setField(POWER, isOn ? 0x01 : 0x00);
   return *this;
 }
 
 SettingsSetRequestPacket &SettingsSetRequestPacket::setMode(const MODE_BYTE mode) {
-  pkt_.setPayloadByte(PLINDEX_MODE, mode);
-  addSettingsFlag(SF_MODE);
+  setField(MODE, mode);
   return *this;
 }
 
 SettingsSetRequestPacket &SettingsSetRequestPacket::setTargetTemperature(const float temperatureDegressC) {
   if (temperatureDegressC < 63.5 && temperatureDegressC > -64.0) {
-    pkt_.setPayloadByte(PLINDEX_TARGET_TEMPERATURE, MUARTUtils::DegCToTempScaleA(temperatureDegressC));
-    pkt_.setPayloadByte(PLINDEX_TARGET_TEMPERATURE_CODE, MUARTUtils::DegCToLegacyTargetTemp(temperatureDegressC));
+    setTemperatureField(TARGET_TEMPERATURE, temperatureDegressC);
+    setTemperatureField(TARGET_TEMPERATURE_CODE, temperatureDegressC);
 
     // TODO: while spawning a warning here is fine, we should (a) only actually send that warning if the system can't
     //       support this setpoint, and (b) clamp the setpoint to the known-acceptable values.
@@ -129,8 +96,6 @@ SettingsSetRequestPacket &SettingsSetRequestPacket::setTargetTemperature(const f
     if (temperatureDegressC < 16 || temperatureDegressC > 31.5 ) {
       ESP_LOGW(PTAG, "Target temp %f is out of range for the legacy temp scale. This may be a problem on older units.", temperatureDegressC);
     }
-
-    addSettingsFlag(SF_TARGET_TEMPERATURE);
   } else {
     ESP_LOGW(PTAG, "Target temp %f is outside valid range - target temperature not set!", temperatureDegressC);
   }
@@ -138,53 +103,47 @@ SettingsSetRequestPacket &SettingsSetRequestPacket::setTargetTemperature(const f
   return *this;
 }
 SettingsSetRequestPacket &SettingsSetRequestPacket::setFan(const FAN_BYTE fan) {
-  pkt_.setPayloadByte(PLINDEX_FAN, fan);
-  addSettingsFlag(SF_FAN);
+  setField(FAN, fan);
   return *this;
 }
 
 SettingsSetRequestPacket &SettingsSetRequestPacket::setVane(const VANE_BYTE vane) {
-  pkt_.setPayloadByte(PLINDEX_VANE, vane);
-  addSettingsFlag(SF_VANE);
+  setField(VANE, vane);
   return *this;
 }
 
 SettingsSetRequestPacket &SettingsSetRequestPacket::setHorizontalVane(const HORIZONTAL_VANE_BYTE horizontal_vane) {
-  pkt_.setPayloadByte(PLINDEX_HORIZONTAL_VANE, horizontal_vane);
-  addSettingsFlag2(SF2_HORIZONTAL_VANE);
+  setField(HORIZONTAL_VANE, horizontal_vane);
   return *this;
 }
 
-// SettingsGetResponsePacket functions
-float SettingsGetResponsePacket::getTargetTemp() const {
-  uint8_t enhancedRawTemp = pkt_.getPayloadByte(PLINDEX_TARGETTEMP);
-
-  if (enhancedRawTemp == 0x00) {
-    uint8_t legacyRawTemp = pkt_.getPayloadByte(PLINDEX_TARGETTEMP_LEGACY);
-    return MUARTUtils::LegacyTargetTempToDegC(legacyRawTemp);
+SettingsSetRequestPacket &SettingsSetRequestPacket::mergeFrom(const SettingsSetRequestPacket &newer) {
+  const uint16_t newFlags = readSetFlags(*newer.pkt_);
+  for (const PacketField &field : SCHEMA.fields) {
+    if (field.setFlags & newFlags) setField(field, newer.getField(field));
   }
+  return *this;
+}
 
-  return MUARTUtils::TempScaleAToDegC(enhancedRawTemp);
+// SettingsGetResponsePacket functions
+float SettingsGetResponsePacket::getTargetTemp() const {
+  // Units that only support the legacy scale leave the enhanced byte zeroed
+  if (getField(TARGET_TEMPERATURE) == 0x00) return getTemperatureField(TARGET_TEMPERATURE_LEGACY);
+  return getTemperatureField(TARGET_TEMPERATURE);
 }
 
 
 // RemoteTemperatureSetRequestPacket functions
 
 float RemoteTemperatureSetRequestPacket::getRemoteTemperature() const {
-  uint8_t rawTempA = pkt_.getPayloadByte(PLINDEX_REMOTE_TEMPERATURE);
-
-  if (rawTempA == 0) {
-    uint8_t rawTempLegacy = pkt_.getPayloadByte(PLINDEX_LEGACY_REMOTE_TEMPERATURE);
-    return MUARTUtils::LegacyRoomTempToDegC(rawTempLegacy);
-  }
-
-  return MUARTUtils::TempScaleAToDegC(rawTempA);
+  if (getField(REMOTE_TEMPERATURE) == 0) return getTemperatureField(REMOTE_TEMPERATURE_LEGACY);
+  return getTemperatureField(REMOTE_TEMPERATURE);
 }
 
 RemoteTemperatureSetRequestPacket &RemoteTemperatureSetRequestPacket::setRemoteTemperature(float temperatureDegressC) {
   if (temperatureDegressC < 63.5 && temperatureDegressC > -64.0) {
-    pkt_.setPayloadByte(PLINDEX_REMOTE_TEMPERATURE, MUARTUtils::DegCToTempScaleA(temperatureDegressC));
-    pkt_.setPayloadByte(PLINDEX_LEGACY_REMOTE_TEMPERATURE, MUARTUtils::DegCToLegacyRoomTemp(temperatureDegressC));
+    setTemperatureField(REMOTE_TEMPERATURE, temperatureDegressC);
+    setTemperatureField(REMOTE_TEMPERATURE_LEGACY, temperatureDegressC);
     setFlags(0x01); // Set flags to say we're providing the temperature
   } else {
     ESP_LOGW(PTAG, "Remote temp %f is outside valid range.", temperatureDegressC);
@@ -198,41 +157,34 @@ RemoteTemperatureSetRequestPacket &RemoteTemperatureSetRequestPacket::useInterna
 
 // CurrentTempGetResponsePacket functions
 float CurrentTempGetResponsePacket::getCurrentTemp() const {
-  uint8_t enhancedRawTemp = pkt_.getPayloadByte(PLINDEX_CURRENTTEMP);
-
   //TODO: Figure out how to handle "out of range" issues here.
-  if (enhancedRawTemp == 0) {
-    uint8_t legacyRawTemp = pkt_.getPayloadByte(PLINDEX_CURRENTTEMP_LEGACY);
-    return MUARTUtils::LegacyRoomTempToDegC(legacyRawTemp);
-  }
-
-  return MUARTUtils::TempScaleAToDegC(enhancedRawTemp);
+  if (getField(CURRENT_TEMPERATURE) == 0) return getTemperatureField(CURRENT_TEMPERATURE_LEGACY);
+  return getTemperatureField(CURRENT_TEMPERATURE);
 }
 
 // ThermostatHelloRequestPacket functions
 std::string ThermostatHelloRequestPacket::getThermostatModel() const {
-  return MUARTUtils::DecodeNBitString((pkt_.getBytes() + 1), 3, 6);
+  return MUARTUtils::DecodeNBitString((pkt_->getBytes() + 1), 3, 6);
 }
 
 std::string ThermostatHelloRequestPacket::getThermostatSerial() const {
-  return MUARTUtils::DecodeNBitString((pkt_.getBytes() + 4), 8, 6);
+  return MUARTUtils::DecodeNBitString((pkt_->getBytes() + 4), 8, 6);
 }
 
 std::string ThermostatHelloRequestPacket::getThermostatVersionString() const {
   char buf[16];
   sprintf(buf, "%02d.%02d.%02d",
-          pkt_.getPayloadByte(13),
-          pkt_.getPayloadByte(14),
-          pkt_.getPayloadByte(15));
+          pkt_->getPayloadByte(13),
+          pkt_->getPayloadByte(14),
+          pkt_->getPayloadByte(15));
 
   return buf;
 }
 
 // ErrorStateGetResponsePacket functions
-std::string ErrorStateGetResponsePacket::getShortCode() const {
+std::string ErrorStateGetResponsePacket::shortCodeName(const uint8_t errorCode) {
   const char* upperAlphabet = "AbEFJLPU";
   const char* lowerAlphabet = "0123456789ABCDEFOHJLPU";
-  const uint8_t errorCode = this->getRawShortCode();
 
   uint8_t lowBits = errorCode & 0x1F;
   if (lowBits > 0x15) {
@@ -246,8 +198,8 @@ std::string ErrorStateGetResponsePacket::getShortCode() const {
 
 // ExtendedConnectResponsePacket functions
 uint8_t ExtendedConnectResponsePacket::getSupportedFanSpeeds() const {
-  uint8_t raw_value = ((pkt_.getPayloadByte(7) & 0x10) >> 2) + ((pkt_.getPayloadByte(8) & 0x08) >> 2) +
-                      ((pkt_.getPayloadByte(9) & 0x02) >> 1);
+  uint8_t raw_value = ((pkt_->getPayloadByte(7) & 0x10) >> 2) + ((pkt_->getPayloadByte(8) & 0x08) >> 2) +
+                      ((pkt_->getPayloadByte(9) & 0x02) >> 1);
 
   switch (raw_value) {
     case 1:
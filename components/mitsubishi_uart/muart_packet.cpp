@@ -8,68 +8,64 @@ Packet::Packet() {
   // TODO: Is this okay?
 }
 
-// std::string Packet::to_string() const {
-//   return format_hex_pretty(&pkt_.getBytes()[0], pkt_.getLength());
-// }
-
-static char format_hex_pretty_char(uint8_t v) { return v >= 10 ? 'A' + (v - 10) : '0' + v; }
-
-std::string Packet::to_string() const {
+void Packet::format(FormatBuffer &out) const {
   // Based on `format_hex_pretty` from ESPHome
-  if (pkt_.getLength() < PACKET_HEADER_SIZE)
-    return "";
-  std::stringstream stream;
-
-  stream << CONSOLE_COLOR_CYAN; //Cyan
-  stream << '[';
+  if (pkt_->getLength() < PACKET_HEADER_SIZE)
+    return;
 
+  out.printf(CONSOLE_COLOR_CYAN "[");
   for (size_t i = 0; i < PACKET_HEADER_SIZE; i++) {
-    if (i==1) {stream << CONSOLE_COLOR_CYAN_BOLD;}
-    stream << format_hex_pretty_char((pkt_.getBytes()[i] & 0xF0) >> 4);
-    stream << format_hex_pretty_char(pkt_.getBytes()[i] & 0x0F);
+    if (i==1) {out.printf(CONSOLE_COLOR_CYAN_BOLD);}
+    out.hex(pkt_->getBytes()[i]);
     if (i<PACKET_HEADER_SIZE-1){
-      stream << '.';
+      out.put('.');
     }
-    if (i==1) {stream << CONSOLE_COLOR_CYAN;}
+    if (i==1) {out.printf(CONSOLE_COLOR_CYAN);}
   }
   // Header close-bracket
-  stream << ']';
-  stream << CONSOLE_COLOR_WHITE; //White
+  out.printf("]" CONSOLE_COLOR_WHITE);
 
   // Payload
-  for (size_t i = PACKET_HEADER_SIZE; i < pkt_.getLength()-1; i++) {
-    stream << format_hex_pretty_char((pkt_.getBytes()[i] & 0xF0) >> 4);
-    stream << format_hex_pretty_char(pkt_.getBytes()[i] & 0x0F);
-    if (i<pkt_.getLength()-2){
-      stream << '.';
+  for (size_t i = PACKET_HEADER_SIZE; i < pkt_->getLength()-1; i++) {
+    out.hex(pkt_->getBytes()[i]);
+    if (i<pkt_->getLength()-2){
+      out.put('.');
     }
   }
 
-  // Space
-  stream << ' ';
-  stream << CONSOLE_COLOR_GREEN; //Green
-
   // Checksum
-  stream << format_hex_pretty_char((pkt_.getBytes()[pkt_.getLength()-1] & 0xF0) >> 4);
-  stream << format_hex_pretty_char(pkt_.getBytes()[pkt_.getLength()-1] & 0x0F);
-
-  stream << CONSOLE_COLOR_NONE; //Reset
-
-  return stream.str();
+  out.printf(" " CONSOLE_COLOR_GREEN);
+  out.hex(pkt_->getBytes()[pkt_->getLength()-1]);
+  out.printf(CONSOLE_COLOR_NONE);
 }
 
 
 void Packet::setFlags(const uint8_t flagValue) {
-  pkt_.setPayloadByte(PLINDEX_FLAGS, flagValue);
+  pkt_->setPayloadByte(PLINDEX_FLAGS, flagValue);
 }
 
 // Adds a flag (ONLY APPLICABLE FOR SOME COMMANDS)
 void Packet::addFlag(const uint8_t flagToAdd) {
-  pkt_.setPayloadByte(PLINDEX_FLAGS, pkt_.getPayloadByte(PLINDEX_FLAGS) | flagToAdd);
+  pkt_->setPayloadByte(PLINDEX_FLAGS, pkt_->getPayloadByte(PLINDEX_FLAGS) | flagToAdd);
 }
 // Adds a flag2 (ONLY APPLICABLE FOR SOME COMMANDS)
 void Packet::addFlag2(const uint8_t flag2ToAdd) {
-  pkt_.setPayloadByte(PLINDEX_FLAGS2, pkt_.getPayloadByte(PLINDEX_FLAGS2) | flag2ToAdd);
+  pkt_->setPayloadByte(PLINDEX_FLAGS2, pkt_->getPayloadByte(PLINDEX_FLAGS2) | flag2ToAdd);
+}
+
+void Packet::setField(const PacketField &field, const uint16_t value) {
+  writeField(*pkt_, field, value);
+  markFieldSet(field);
+}
+
+void Packet::setTemperatureField(const PacketField &field, const float degreesC) {
+  writeTemperature(*pkt_, field, degreesC);
+  markFieldSet(field);
+}
+
+void Packet::markFieldSet(const PacketField &field) {
+  if (field.setFlags & 0xff) addFlag(field.setFlags & 0xff);
+  if (field.setFlags >> 8) addFlag2(field.setFlags >> 8);
 }
 
 }  // namespace mitsubishi_uart
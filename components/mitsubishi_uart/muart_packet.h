@@ -3,14 +3,15 @@
 #include "esphome/core/component.h"
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/uart/uart.h"
+#include "muart_framepool.h"
 #include "muart_rawpacket.h"
+#include "muart_schema.h"
 #include "muart_utils.h"
-#include <sstream>
 
 namespace esphome {
 namespace mitsubishi_uart {
 static const char *PACKETS_TAG = "mitsubishi_uart.packets";
-#define LOGPACKET(packet, direction) ESP_LOGD(PACKETS_TAG, "%s [%02x] %s", direction, packet.getPacketType(), packet.to_string().c_str());
+#define LOGPACKET(packet, direction) MUART_LOGD_PACKET(PACKETS_TAG, direction " ", packet);
 
 #define CONSOLE_COLOR_NONE "\033[0m"
 #define CONSOLE_COLOR_GREEN "\033[0;32m"
@@ -21,27 +22,34 @@ static const char *PACKETS_TAG = "mitsubishi_uart.packets";
 
 class PacketProcessor;
 
-// Generic Base Packet wrapper over RawPacket
+/* Generic Base Packet wrapper over RawPacket.  Packets are views over a frame in the FramePool, so copying a packet
+(or queueing it) shares the frame instead of copying its bytes.  A packet holds nothing but its frame handle (no
+vtable), so the subclasses only add accessors; format() is resolved by the static type, via formatPacket().
+*/
 class Packet {
   public:
-    Packet(RawPacket&& pkt) : pkt_(std::move(pkt)) {}; // TODO: Confirm this needs std::move if call to constructor ALSO has move
+    Packet(const RawPacket &pkt) : pkt_(framePool().acquire(pkt)) {}; // Copies the frame into the pool
+    Packet(const FrameHandle &frame) : pkt_(frame) {};  // A view over an existing frame
     Packet(); // For optional<> construction
 
-    // Returns a (more) human readable string of the packet
-    virtual std::string to_string() const;
+    // Writes a (more) human readable description of the packet into a caller-supplied buffer.  Subclasses hide
+    // this with their own description (use formatPacket() so the right one is picked).
+    void format(FormatBuffer &out) const;
 
     // Is a response packet expected when this packet is sent.  Defaults to true since
-    // most requests receive a response.
-    bool isResponseExpected() const {return responseExpected;};
-    void setResponseExpected(bool expectResponse) {responseExpected = expectResponse;};
+    // most requests receive a response.  Kept in the frame's metadata.
+    bool isResponseExpected() const {return pkt_->isResponseExpected();};
+    void setResponseExpected(bool expectResponse) {pkt_->setResponseExpected(expectResponse);};
 
     // Passthrough methods to RawPacket
-    RawPacket& rawPacket() {return pkt_;};
-    uint8_t getPacketType() const {return pkt_.getPacketType();}
-    bool isChecksumValid() const {return pkt_.isChecksumValid();};
+    RawPacket& rawPacket() {return *pkt_;};
+    const RawPacket& rawPacket() const {return *pkt_;};
+    const FrameHandle& frame() const {return pkt_;};
+    uint8_t getPacketType() const {return pkt_->getPacketType();}
+    bool isChecksumValid() const {return pkt_->isChecksumValid();};
 
     // Returns flags (ONLY APPLICABLE FOR SOME COMMANDS)
-    uint8_t getFlags() const {return pkt_.getPayloadByte(PLINDEX_FLAGS);}
+    uint8_t getFlags() const {return pkt_->getPayloadByte(PLINDEX_FLAGS);}
     // Sets flags (ONLY APPLICABLE FOR SOME COMMANDS)
     void setFlags(const uint8_t flagValue);
     // Adds a flag (ONLY APPLICABLE FOR SOME COMMANDS)
@@ -49,18 +57,34 @@ class Packet {
     // Adds a flag2 (ONLY APPLICABLE FOR SOME COMMANDS)
     void addFlag2(const uint8_t flag2ToAdd);
 
-    SourceBridge getSourceBridge() const { return pkt_.getSourceBridge(); }
-    ControllerAssociation getControllerAssociation() const { return pkt_.getControllerAssociation(); }
+    SourceBridge getSourceBridge() const { return pkt_->getSourceBridge(); }
+    ControllerAssociation getControllerAssociation() const { return pkt_->getControllerAssociation(); }
 
   protected:
     static const int PLINDEX_FLAGS = 1;
     static const int PLINDEX_FLAGS2 = 2;
 
-    RawPacket pkt_;
+    // Accessors for the fields of a subclass's schema (see muart_schema.h)
+    uint16_t getField(const PacketField &field) const { return readField(*pkt_, field); }
+    float getTemperatureField(const PacketField &field) const { return readTemperature(*pkt_, field); }
+    // Writes a field, marking it as set in the flags if it has set flags
+    void setField(const PacketField &field, uint16_t value);
+    void setTemperatureField(const PacketField &field, float degreesC);
+    // Appends the decoded fields of the schema to a description
+    template<size_t N> void formatFields(FormatBuffer &out, const PacketSchema<N> &schema) const {
+      out.printf(CONSOLE_COLOR_PURPLE "\n");
+      schema.format(out, *pkt_);
+    }
+
+    FrameHandle pkt_;
+
   private:
-    bool responseExpected = true;
+    void markFieldSet(const PacketField &field);
 };
 
+// Writes a packet using the description of its (static) packet class
+template<class P> void formatPacket(FormatBuffer &out, const P &packet) { packet.format(out); }
+
 ////
 // Connect
 ////
@@ -72,11 +96,12 @@ class ConnectRequestPacket : public Packet {
     return INSTANCE;
   }
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
  private:
-  ConnectRequestPacket() : Packet(RawPacket(PacketType::connect_request, 2)) {
-    pkt_.setPayloadByte(0, 0xca);
-    pkt_.setPayloadByte(1, 0x01);
+  // Like the other static request instances, kept in a pinned slot rather than holding one of the pool's
+  ConnectRequestPacket() : Packet(framePool().emplacePinned(PacketType::connect_request, 2)) {
+    pkt_->setPayloadByte(0, 0xca);
+    pkt_->setPayloadByte(1, 0x01);
   }
 };
 
@@ -84,7 +109,7 @@ class ConnectResponsePacket : public Packet {
 
   public:
     using Packet::Packet;
-    std::string to_string() const override;
+    void format(FormatBuffer &out) const;
 };
 
 ////
@@ -98,39 +123,67 @@ class ExtendedConnectRequestPacket : public Packet {
   }
   using Packet::Packet;
  private:
-  ExtendedConnectRequestPacket() : Packet(RawPacket(PacketType::extended_connect_request, 1)) {
-    pkt_.setPayloadByte(0, 0xc9);
+  ExtendedConnectRequestPacket() : Packet(framePool().emplacePinned(PacketType::extended_connect_request, 1)) {
+    pkt_->setPayloadByte(0, 0xc9);
   }
 };
 
 class ExtendedConnectResponsePacket : public Packet {
-  using Packet::Packet;
-
- public:
   // Byte 7
-  bool isHeatDisabled() const { return pkt_.getPayloadByte(7) & 0x02; }
-  bool supportsVane() const { return pkt_.getPayloadByte(7) & 0x20; }
-  bool supportsVaneSwing() const { return pkt_.getPayloadByte(7) & 0x40; }
-
+  static constexpr PacketField HEAT_DISABLED = bitField("HeatDisabled", 7, 0x02);
+  static constexpr PacketField FAN_SPEEDS_BIT2 = bitField("FanSpeedsBit2", 7, 0x10);
+  static constexpr PacketField SUPPORTS_VANE = bitField("SupportsVane", 7, 0x20);
+  static constexpr PacketField SUPPORTS_VANE_SWING = bitField("SupportsVaneSwing", 7, 0x40);
   // Byte 8
-  bool isDryDisabled() const { return pkt_.getPayloadByte(8) & 0x01; }
-  bool isFanDisabled() const { return pkt_.getPayloadByte(8) & 0x02; }
-  bool hasExtendedTemperatureRange() const { return pkt_.getPayloadByte(8) & 0x04; }
-  bool autoFanSpeedDisabled() const { return pkt_.getPayloadByte(8) & 0x10; }
-  bool supportsInstallerSettings() const { return pkt_.getPayloadByte(8) & 0x20; }
-  bool supportsTestMode() const { return pkt_.getPayloadByte(8) & 0x40; }
-  bool supportsDryTemperature() const { return pkt_.getPayloadByte(8) & 0x80; }
-
+  static constexpr PacketField DRY_DISABLED = bitField("DryDisabled", 8, 0x01);
+  static constexpr PacketField FAN_DISABLED = bitField("FanDisabled", 8, 0x02);
+  static constexpr PacketField EXTENDED_TEMP_RANGE = bitField("ExtTempRange", 8, 0x04);
+  static constexpr PacketField FAN_SPEEDS_BIT1 = bitField("FanSpeedsBit1", 8, 0x08);
+  static constexpr PacketField AUTO_FAN_DISABLED = bitField("AutoFanDisabled", 8, 0x10);
+  static constexpr PacketField INSTALLER_SETTINGS = bitField("InstallerSettings", 8, 0x20);
+  static constexpr PacketField TEST_MODE = bitField("TestMode", 8, 0x40);
+  static constexpr PacketField DRY_TEMPERATURE = bitField("DryTemp", 8, 0x80);
   // Byte 9
-  bool hasStatusDisplay() const { return pkt_.getPayloadByte(9) & 0x01; }
-
+  static constexpr PacketField STATUS_DISPLAY = bitField("StatusDisplay", 9, 0x01);
+  static constexpr PacketField FAN_SPEEDS_BIT0 = bitField("FanSpeedsBit0", 9, 0x02);
   // Bytes 10-15
-  float getMinCoolDrySetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(10)); }
-  float getMaxCoolDrySetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(11)); }
-  float getMinHeatingSetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(12)); }
-  float getMaxHeatingSetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(13)); }
-  float getMinAutoSetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(14)); }
-  float getMaxAutoSetpoint() const { return MUARTUtils::TempScaleAToDegC(pkt_.getPayloadByte(15)); }
+  static constexpr PacketField MIN_COOL_DRY_SETPOINT = byteField("MinCoolDrySetpoint", 10, FieldScale::temp_scale_a);
+  static constexpr PacketField MAX_COOL_DRY_SETPOINT = byteField("MaxCoolDrySetpoint", 11, FieldScale::temp_scale_a);
+  static constexpr PacketField MIN_HEATING_SETPOINT = byteField("MinHeatSetpoint", 12, FieldScale::temp_scale_a);
+  static constexpr PacketField MAX_HEATING_SETPOINT = byteField("MaxHeatSetpoint", 13, FieldScale::temp_scale_a);
+  static constexpr PacketField MIN_AUTO_SETPOINT = byteField("MinAutoSetpoint", 14, FieldScale::temp_scale_a);
+  static constexpr PacketField MAX_AUTO_SETPOINT = byteField("MaxAutoSetpoint", 15, FieldScale::temp_scale_a);
+
+  static constexpr auto SCHEMA =
+      makeSchema(16, HEAT_DISABLED, FAN_SPEEDS_BIT2, SUPPORTS_VANE, SUPPORTS_VANE_SWING, DRY_DISABLED, FAN_DISABLED,
+                 EXTENDED_TEMP_RANGE, FAN_SPEEDS_BIT1, AUTO_FAN_DISABLED, INSTALLER_SETTINGS, TEST_MODE,
+                 DRY_TEMPERATURE, STATUS_DISPLAY, FAN_SPEEDS_BIT0, MIN_COOL_DRY_SETPOINT, MAX_COOL_DRY_SETPOINT,
+                 MIN_HEATING_SETPOINT, MAX_HEATING_SETPOINT, MIN_AUTO_SETPOINT, MAX_AUTO_SETPOINT);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid extended connect response schema");
+
+  using Packet::Packet;
+
+ public:
+  bool isHeatDisabled() const { return getField(HEAT_DISABLED); }
+  bool supportsVane() const { return getField(SUPPORTS_VANE); }
+  bool supportsVaneSwing() const { return getField(SUPPORTS_VANE_SWING); }
+
+  bool isDryDisabled() const { return getField(DRY_DISABLED); }
+  bool isFanDisabled() const { return getField(FAN_DISABLED); }
+  bool hasExtendedTemperatureRange() const { return getField(EXTENDED_TEMP_RANGE); }
+  bool autoFanSpeedDisabled() const { return getField(AUTO_FAN_DISABLED); }
+  bool supportsInstallerSettings() const { return getField(INSTALLER_SETTINGS); }
+  bool supportsTestMode() const { return getField(TEST_MODE); }
+  bool supportsDryTemperature() const { return getField(DRY_TEMPERATURE); }
+
+  bool hasStatusDisplay() const { return getField(STATUS_DISPLAY); }
+
+  float getMinCoolDrySetpoint() const { return getTemperatureField(MIN_COOL_DRY_SETPOINT); }
+  float getMaxCoolDrySetpoint() const { return getTemperatureField(MAX_COOL_DRY_SETPOINT); }
+  float getMinHeatingSetpoint() const { return getTemperatureField(MIN_HEATING_SETPOINT); }
+  float getMaxHeatingSetpoint() const { return getTemperatureField(MAX_HEATING_SETPOINT); }
+  float getMinAutoSetpoint() const { return getTemperatureField(MIN_AUTO_SETPOINT); }
+  float getMaxAutoSetpoint() const { return getTemperatureField(MAX_AUTO_SETPOINT); }
 
   // Things that have to exist, but we don't know where yet.
   bool supportsHVane() const { return true; }
@@ -142,7 +195,7 @@ class ExtendedConnectResponsePacket : public Packet {
   // This will also not handle things like MHK2 humidity detection.
   climate::ClimateTraits asTraits() const;
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 ////
@@ -159,100 +212,144 @@ class GetRequestPacket : public Packet {
     return INSTANCE;
   }
   static GetRequestPacket& getStatusInstance() {
-    static GetRequestPacket INSTANCE = GetRequestPacket(GetCommand::standby);
+    static GetRequestPacket INSTANCE = GetRequestPacket(GetCommand::status);
     return INSTANCE;
   }
   static GetRequestPacket& getStandbyInstance() {
-    static GetRequestPacket INSTANCE = GetRequestPacket(GetCommand::status);
+    static GetRequestPacket INSTANCE = GetRequestPacket(GetCommand::standby);
     return INSTANCE;
   }
   static GetRequestPacket& getErrorInfoInstance() {
     static GetRequestPacket INSTANCE = GetRequestPacket(GetCommand::error_info);
     return INSTANCE;
   }
+  // Returns the request instance for a polled command (defaults to settings for unpolled commands)
+  static GetRequestPacket& getInstance(GetCommand get_command) {
+    switch (get_command) {
+      case GetCommand::current_temp:
+        return getCurrentTempInstance();
+      case GetCommand::error_info:
+        return getErrorInfoInstance();
+      case GetCommand::status:
+        return getStatusInstance();
+      case GetCommand::standby:
+        return getStandbyInstance();
+      case GetCommand::settings:
+      default:
+        return getSettingsInstance();
+    }
+  }
   using Packet::Packet;
 
  private:
-  GetRequestPacket(GetCommand get_command) : Packet(RawPacket(PacketType::get_request, 1)) {
-    pkt_.setPayloadByte(0, static_cast<uint8_t>(get_command));
+  GetRequestPacket(GetCommand get_command) : Packet(framePool().emplacePinned(PacketType::get_request, 1)) {
+    pkt_->setPayloadByte(0, static_cast<uint8_t>(get_command));
   }
 };
 
 class SettingsGetResponsePacket : public Packet {
-  static const int PLINDEX_POWER = 3;
-  static const int PLINDEX_MODE = 4;
-  static const int PLINDEX_TARGETTEMP_LEGACY = 5;
-  static const int PLINDEX_FAN = 6;
-  static const int PLINDEX_VANE = 7;
-  static const int PLINDEX_PROHIBITFLAGS = 8;
-  static const int PLINDEX_HVANE = 10;
-  static const int PLINDEX_TARGETTEMP = 11;
+  static constexpr PacketField POWER = byteField("Power", 3);
+  static constexpr PacketField MODE = byteField("Mode", 4);
+  static constexpr PacketField TARGET_TEMPERATURE_LEGACY = byteField("TargetTempLegacy", 5, FieldScale::legacy_target_temp);
+  static constexpr PacketField FAN = byteField("Fan", 6);
+  static constexpr PacketField VANE = byteField("Vane", 7);
+  static constexpr PacketField POWER_LOCK = bitField("PowerLock", 8, 0x01);
+  static constexpr PacketField MODE_LOCK = bitField("ModeLock", 8, 0x02);
+  static constexpr PacketField TEMP_LOCK = bitField("TempLock", 8, 0x04);
+  static constexpr PacketField HORIZONTAL_VANE = byteField("HVane", 10);
+  static constexpr PacketField TARGET_TEMPERATURE = byteField("TargetTemp", 11, FieldScale::temp_scale_a);
+
+  static constexpr auto SCHEMA = makeSchema(16, POWER, MODE, TARGET_TEMPERATURE_LEGACY, FAN, VANE, POWER_LOCK,
+                                            MODE_LOCK, TEMP_LOCK, HORIZONTAL_VANE, TARGET_TEMPERATURE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid settings response schema");
+
   using Packet::Packet;
 
  public:
-  uint8_t getPower() const { return pkt_.getPayloadByte(PLINDEX_POWER); }
-  uint8_t getMode() const { return pkt_.getPayloadByte(PLINDEX_MODE); }
-  uint8_t getFan() const { return pkt_.getPayloadByte(PLINDEX_FAN); }
-  uint8_t getVane() const { return pkt_.getPayloadByte(PLINDEX_VANE); }
-  bool lockedPower() const { return pkt_.getPayloadByte(PLINDEX_PROHIBITFLAGS) & 0x01; }
-  bool lockedMode() const { return pkt_.getPayloadByte(PLINDEX_PROHIBITFLAGS) & 0x02; }
-  bool lockedTemp() const { return pkt_.getPayloadByte(PLINDEX_PROHIBITFLAGS) & 0x04; }
-  uint8_t getHorizontalVane() const { return pkt_.getPayloadByte(PLINDEX_HVANE); }
+  uint8_t getPower() const { return getField(POWER); }
+  uint8_t getMode() const { return getField(MODE); }
+  uint8_t getFan() const { return getField(FAN); }
+  uint8_t getVane() const { return getField(VANE); }
+  bool lockedPower() const { return getField(POWER_LOCK); }
+  bool lockedMode() const { return getField(MODE_LOCK); }
+  bool lockedTemp() const { return getField(TEMP_LOCK); }
+  uint8_t getHorizontalVane() const { return getField(HORIZONTAL_VANE); }
 
   float getTargetTemp() const;
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 class CurrentTempGetResponsePacket : public Packet {
-  static const int PLINDEX_CURRENTTEMP_LEGACY = 3;
-  static const int PLINDEX_CURRENTTEMP = 6;
+  static constexpr PacketField CURRENT_TEMPERATURE_LEGACY = byteField("TempLegacy", 3, FieldScale::legacy_room_temp);
+  static constexpr PacketField CURRENT_TEMPERATURE = byteField("Temp", 6, FieldScale::temp_scale_a);
+
+  static constexpr auto SCHEMA = makeSchema(16, CURRENT_TEMPERATURE_LEGACY, CURRENT_TEMPERATURE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid current temperature response schema");
+
   using Packet::Packet;
 
  public:
   float getCurrentTemp() const;
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 class StatusGetResponsePacket : public Packet {
-  static const int PLINDEX_COMPRESSOR_FREQUENCY = 3;
-  static const int PLINDEX_OPERATING = 4;
+  static constexpr PacketField COMPRESSOR_FREQUENCY = byteField("CompressorFrequency", 3, FieldScale::number);
+  static constexpr PacketField OPERATING = bitField("Operating", 4, 0xff);
 
-  using Packet::Packet;
+  static constexpr auto SCHEMA = makeSchema(16, COMPRESSOR_FREQUENCY, OPERATING);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid status response schema");
 
+  using Packet::Packet;
 
  public:
-  uint8_t getCompressorFrequency() const { return pkt_.getPayloadByte(PLINDEX_COMPRESSOR_FREQUENCY); }
-  bool getOperating() const { return pkt_.getPayloadByte(PLINDEX_OPERATING); }
-  std::string to_string() const override;
+  uint8_t getCompressorFrequency() const { return getField(COMPRESSOR_FREQUENCY); }
+  bool getOperating() const { return getField(OPERATING); }
+  void format(FormatBuffer &out) const;
 };
 
 class StandbyGetResponsePacket : public Packet {
-  static const int PLINDEX_STATUSFLAGS = 3;
-  static const int PLINDEX_ACTUALFAN = 4;
-  static const int PLINDEX_AUTOMODE = 5;
+  static constexpr PacketField SERVICE_FILTER = bitField("ServiceFilter", 3, 0x01);
+  static constexpr PacketField DEFROST = bitField("Defrost", 3, 0x02);
+  static constexpr PacketField HOT_ADJUST = bitField("HotAdjust", 3, 0x04);
+  static constexpr PacketField STANDBY = bitField("Standby", 3, 0x08);
+  static constexpr PacketField ACTUAL_FAN = byteField("ActualFan", 4);
+  static constexpr PacketField AUTO_MODE = byteField("AutoMode", 5);
+
+  static constexpr auto SCHEMA = makeSchema(16, SERVICE_FILTER, DEFROST, HOT_ADJUST, STANDBY, ACTUAL_FAN, AUTO_MODE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid standby response schema");
+
   using Packet::Packet;
 
  public:
-  bool serviceFilter() const { return pkt_.getPayloadByte(PLINDEX_STATUSFLAGS) & 0x01; }
-  bool inDefrost() const { return pkt_.getPayloadByte(PLINDEX_STATUSFLAGS) & 0x02; }
-  bool inHotAdjust() const { return pkt_.getPayloadByte(PLINDEX_STATUSFLAGS) & 0x04; }
-  bool inStandby() const { return pkt_.getPayloadByte(PLINDEX_STATUSFLAGS) & 0x08; }
-  uint8_t getActualFanSpeed() const { return pkt_.getPayloadByte(PLINDEX_ACTUALFAN); }
-  uint8_t getAutoMode() const { return pkt_.getPayloadByte(PLINDEX_AUTOMODE); }
-  std::string to_string() const override;
+  bool serviceFilter() const { return getField(SERVICE_FILTER); }
+  bool inDefrost() const { return getField(DEFROST); }
+  bool inHotAdjust() const { return getField(HOT_ADJUST); }
+  bool inStandby() const { return getField(STANDBY); }
+  uint8_t getActualFanSpeed() const { return getField(ACTUAL_FAN); }
+  uint8_t getAutoMode() const { return getField(AUTO_MODE); }
+  void format(FormatBuffer &out) const;
 };
 
 class ErrorStateGetResponsePacket : public Packet {
+  static constexpr PacketField ERROR_CODE = wordField("ErrorCode", 4);
+  static constexpr PacketField SHORT_CODE = byteField("ShortCode", 6);
+
+  static constexpr auto SCHEMA = makeSchema(16, ERROR_CODE, SHORT_CODE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid error state response schema");
+
   using Packet::Packet;
  public:
-  uint16_t getErrorCode() const {return pkt_.getPayloadByte(4) << 8 | pkt_.getPayloadByte(5);}
-  uint8_t getRawShortCode() const {return pkt_.getPayloadByte(6);}
-  std::string getShortCode() const;
+  uint16_t getErrorCode() const {return getField(ERROR_CODE);}
+  uint8_t getRawShortCode() const {return getField(SHORT_CODE);}
+  std::string getShortCode() const { return shortCodeName(getRawShortCode()); }
+  // The two-character code shown on the unit for a raw short code
+  static std::string shortCodeName(uint8_t rawShortCode);
 
   bool errorPresent() const { return getErrorCode() != 0x8000 || getRawShortCode() != 0x00; }
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 ////
@@ -260,14 +357,6 @@ class ErrorStateGetResponsePacket : public Packet {
 ////
 
 class SettingsSetRequestPacket : public Packet {
-  static const int PLINDEX_POWER = 3;
-  static const int PLINDEX_MODE = 4;
-  static const int PLINDEX_TARGET_TEMPERATURE_CODE = 6;
-  static const int PLINDEX_FAN = 6;
-  static const int PLINDEX_VANE = 7;
-  static const int PLINDEX_HORIZONTAL_VANE = 13;
-  static const int PLINDEX_TARGET_TEMPERATURE = 14;
-
   enum SETTING_FLAG : uint8_t {
     SF_POWER = 0x01,
     SF_MODE = 0x02,
@@ -280,6 +369,23 @@ class SettingsSetRequestPacket : public Packet {
     SF2_HORIZONTAL_VANE = 0x01,
   };
 
+  // Each setting carries the flag that tells the heatpump it's being set (flags2 in the high byte)
+  static constexpr PacketField FLAGS = byteField("Flags", PLINDEX_SET_FLAGS);
+  static constexpr PacketField FLAGS2 = byteField("Flags2", PLINDEX_SET_FLAGS2);
+  static constexpr PacketField POWER = byteField("Power", 3, FieldScale::raw, SF_POWER);
+  static constexpr PacketField MODE = byteField("Mode", 4, FieldScale::raw, SF_MODE);
+  static constexpr PacketField TARGET_TEMPERATURE_CODE =
+      byteField("TargetTempLegacy", 5, FieldScale::legacy_target_temp, SF_TARGET_TEMPERATURE);
+  static constexpr PacketField FAN = byteField("Fan", 6, FieldScale::raw, SF_FAN);
+  static constexpr PacketField VANE = byteField("Vane", 7, FieldScale::raw, SF_VANE);
+  static constexpr PacketField HORIZONTAL_VANE = byteField("HVane", 13, FieldScale::raw, SF2_HORIZONTAL_VANE << 8);
+  static constexpr PacketField TARGET_TEMPERATURE =
+      byteField("TargetTemp", 14, FieldScale::temp_scale_a, SF_TARGET_TEMPERATURE);
+
+  static constexpr auto SCHEMA = makeSchema(16, FLAGS, FLAGS2, POWER, MODE, TARGET_TEMPERATURE_CODE, FAN, VANE,
+                                            HORIZONTAL_VANE, TARGET_TEMPERATURE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid settings set request schema");
+
  public:
   enum MODE_BYTE : uint8_t {
     MODE_BYTE_HEAT = 0x01,
@@ -319,7 +425,7 @@ class SettingsSetRequestPacket : public Packet {
     HV_SWING = 0x0c,
   };
 
-  SettingsSetRequestPacket() : Packet(RawPacket(PacketType::set_request, 16)) { pkt_.setPayloadByte(0, static_cast<uint8_t>(SetCommand::settings)); }
+  SettingsSetRequestPacket() : Packet(framePool().emplace(PacketType::set_request, SCHEMA.payloadSize)) { pkt_->setPayloadByte(0, static_cast<uint8_t>(SetCommand::settings)); }
   using Packet::Packet;
 
   SettingsSetRequestPacket &setPower(bool isOn);
@@ -329,18 +435,24 @@ class SettingsSetRequestPacket : public Packet {
   SettingsSetRequestPacket &setVane(VANE_BYTE vane);
   SettingsSetRequestPacket &setHorizontalVane(HORIZONTAL_VANE_BYTE horizontal_vane);
 
- private:
-  void addSettingsFlag(SETTING_FLAG flagToAdd);
-  void addSettingsFlag2(SETTING_FLAG2 flag2ToAdd);
+  // Copies every setting flagged in `newer` into this packet (combining the flags), so that a single packet
+  // carries the most recent value of each setting from both.
+  SettingsSetRequestPacket &mergeFrom(const SettingsSetRequestPacket &newer);
+
+  void format(FormatBuffer &out) const;
 };
 
 class RemoteTemperatureSetRequestPacket : public Packet {
-  static const uint8_t PLINDEX_LEGACY_REMOTE_TEMPERATURE = 2;
-  static const uint8_t PLINDEX_REMOTE_TEMPERATURE = 3;
+  static constexpr PacketField FLAGS = byteField("Flags", PLINDEX_SET_FLAGS);
+  static constexpr PacketField REMOTE_TEMPERATURE_LEGACY = byteField("TempLegacy", 2, FieldScale::legacy_room_temp);
+  static constexpr PacketField REMOTE_TEMPERATURE = byteField("Temp", 3, FieldScale::temp_scale_a);
+
+  static constexpr auto SCHEMA = makeSchema(4, FLAGS, REMOTE_TEMPERATURE_LEGACY, REMOTE_TEMPERATURE);
+  static_assert(SCHEMA.fitsPayload() && !SCHEMA.hasOverlaps(), "Invalid remote temperature request schema");
 
   public:
-  RemoteTemperatureSetRequestPacket() : Packet(RawPacket(PacketType::set_request, 4)) {
-    pkt_.setPayloadByte(0, static_cast<uint8_t>(SetCommand::remote_temperature));
+  RemoteTemperatureSetRequestPacket() : Packet(framePool().emplace(PacketType::set_request, SCHEMA.payloadSize)) {
+    pkt_->setPayloadByte(0, static_cast<uint8_t>(SetCommand::remote_temperature));
   }
   using Packet::Packet;
 
@@ -349,41 +461,49 @@ class RemoteTemperatureSetRequestPacket : public Packet {
   RemoteTemperatureSetRequestPacket &setRemoteTemperature(float temperatureDegressC);
   RemoteTemperatureSetRequestPacket &useInternalTemperature();
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 class RemoteTemperatureSetResponsePacket : public Packet {
   using Packet::Packet;
 public:
-  RemoteTemperatureSetResponsePacket() : Packet(RawPacket(PacketType::set_response, 16)) {}
+  RemoteTemperatureSetResponsePacket() : Packet(framePool().emplace(PacketType::set_response, 16)) {}
 };
 
 // Sent by MHK2 but with no response; defined to allow setResponseExpected(false)
 class ThermostatHelloRequestPacket : public Packet {
   using Packet::Packet;
  public:
-  ThermostatHelloRequestPacket() : Packet(RawPacket(PacketType::set_request, 4)) {
-    pkt_.setPayloadByte(0, static_cast<uint8_t>(SetCommand::thermostat_hello));
+  ThermostatHelloRequestPacket() : Packet(framePool().emplace(PacketType::set_request, 4)) {
+    pkt_->setPayloadByte(0, static_cast<uint8_t>(SetCommand::thermostat_hello));
   }
 
   std::string getThermostatModel() const;
   std::string getThermostatSerial() const;
   std::string getThermostatVersionString() const;
 
-  std::string to_string() const override;
+  void format(FormatBuffer &out) const;
 };
 
 // Sent by MHK2 but with no response; defined to allow setResponseExpected(false)
 class A9GetRequestPacket : public Packet {
   using Packet::Packet;
  public:
-  A9GetRequestPacket() : Packet(RawPacket(PacketType::get_request, 10)) {
-    pkt_.setPayloadByte(0, static_cast<uint8_t>(GetCommand::a_9));
+  A9GetRequestPacket() : Packet(framePool().emplace(PacketType::get_request, 10)) {
+    pkt_->setPayloadByte(0, static_cast<uint8_t>(GetCommand::a_9));
   }
 };
 
+// Packets are only ever a frame handle; subclasses add behaviour, never data
+static_assert(sizeof(Packet) == sizeof(FrameHandle), "Packet must not add data to its frame handle");
+static_assert(sizeof(SettingsSetRequestPacket) == sizeof(Packet), "Packet subclasses must not add data");
+static_assert(sizeof(ExtendedConnectResponsePacket) == sizeof(Packet), "Packet subclasses must not add data");
+
 class PacketProcessor {
   public:
+    // Called with each valid frame before it is decoded, so it can be forwarded to the other bridge straight away.
+    // A forwarded frame is marked as such (it's shared with the other bridge's queue, not copied).
+    virtual void cutThrough(const FrameHandle &frame) {};
     virtual void processPacket(const Packet &packet) {};
     virtual void processPacket(const ConnectRequestPacket &packet) {};
     virtual void processPacket(const ConnectResponsePacket &packet) {};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "muart_framepool.h"
+#include "muart_ringbuffer.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// A raw frame waiting in the send queue, along with whether the bridge should wait for a response to it
+struct QueuedPacket {
+  FrameHandle packet;
+  bool responseExpected;
+  uint32_t queuedMillis;  // When the packet was added to the queue
+};
+// Queue lanes hold handles, not frames, so a queued packet costs a pointer and its bookkeeping
+static_assert(sizeof(QueuedPacket) <= sizeof(FrameHandle) + 2 * sizeof(uint32_t), "QueuedPacket has grown");
+
+// Running totals of how long packets waited in a queue lane before being sent
+struct QueueWaitStats {
+  uint32_t count = 0;
+  uint32_t totalMillis = 0;
+  uint32_t maxMillis = 0;
+
+  void record(uint32_t waitMillis) {
+    count++;
+    totalMillis += waitMillis;
+    if (waitMillis > maxMillis) maxMillis = waitMillis;
+  }
+  uint32_t averageMillis() const { return count == 0 ? 0 : totalMillis / count; }
+};
+
+/* A fixed-size send queue made up of LANES FIFO lanes, where lane 0 has the highest priority.  The next packet
+is always taken from the highest priority non-empty lane, unless the head of a lower lane has been waiting longer
+than the starvation timeout, in which case the longest-waiting head is sent instead so that lower lanes still make
+progress.
+*/
+template<size_t LANES, size_t N> class PacketQueue {
+ public:
+  explicit PacketQueue(uint32_t starvation_timeout_ms) : starvationTimeoutMillis{starvation_timeout_ms} {}
+
+  bool push(size_t lane, const QueuedPacket &queued) { return lanes_[lane].push(queued); }
+
+  bool empty() const {
+    for (size_t i = 0; i < LANES; i++) {
+      if (!lanes_[i].empty()) return false;
+    }
+    return true;
+  }
+
+  // Total number of packets queued across all lanes
+  size_t size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < LANES; i++) total += lanes_[i].size();
+    return total;
+  }
+
+  // Index of the lane the next packet should be sent from, or -1 if all lanes are empty.
+  int nextLane(uint32_t now) const {
+    int highest = -1;
+    int starved = -1;
+    uint32_t starvedWait = 0;
+    for (size_t i = 0; i < LANES; i++) {
+      if (lanes_[i].empty()) continue;
+      if (highest < 0) highest = i;
+      const uint32_t wait = now - lanes_[i].front().queuedMillis;
+      if (wait > starvationTimeoutMillis && wait > starvedWait) {
+        starved = i;
+        starvedWait = wait;
+      }
+    }
+    return starved >= 0 ? starved : highest;
+  }
+
+  RingBuffer<QueuedPacket, N> &lane(size_t lane) { return lanes_[lane]; }
+  const RingBuffer<QueuedPacket, N> &lane(size_t lane) const { return lanes_[lane]; }
+
+  // Removes the head of the specified lane, recording how long it waited
+  void pop(size_t lane, uint32_t now) {
+    if (lanes_[lane].empty()) return;
+    waitStats_[lane].record(now - lanes_[lane].front().queuedMillis);
+    lanes_[lane].pop();
+  }
+
+  const QueueWaitStats &waitStats(size_t lane) const { return waitStats_[lane]; }
+
+ private:
+  RingBuffer<QueuedPacket, N> lanes_[LANES];
+  QueueWaitStats waitStats_[LANES];
+  uint32_t starvationTimeoutMillis;
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
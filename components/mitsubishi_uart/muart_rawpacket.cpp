@@ -1,24 +1,57 @@
 #include "muart_rawpacket.h"
+#include <algorithm>
 
 namespace esphome {
 namespace mitsubishi_uart {
 
+void FormatBuffer::printf(const char *format, ...) {
+  if (length_ + 1 >= size_) return;
+  va_list args;
+  va_start(args, format);
+  const int written = vsnprintf(buffer_ + length_, size_ - length_, format, args);
+  va_end(args);
+  if (written > 0) length_ = std::min(length_ + written, size_ - 1);
+}
+
+void FormatBuffer::put(char c) {
+  if (length_ + 1 >= size_) return;
+  buffer_[length_++] = c;
+  buffer_[length_] = '\0';
+}
+
+void FormatBuffer::hex(uint8_t value) {
+  static const char *DIGITS = "0123456789ABCDEF";
+  if (length_ + 2 >= size_) return;
+  buffer_[length_++] = DIGITS[value >> 4];
+  buffer_[length_++] = DIGITS[value & 0x0F];
+  buffer_[length_] = '\0';
+}
+
+void formatPacket(FormatBuffer &out, const RawPacket &frame) {
+  for (size_t i = 0; i < frame.getLength(); i++) {
+    if (i > 0) out.put('.');
+    out.hex(frame.getBytes()[i]);
+  }
+}
 
 // Creates an empty packet
 RawPacket::RawPacket(PacketType packet_type, uint8_t payload_size, SourceBridge source_bridge, ControllerAssociation controller_association)
-    : length{(uint8_t)(payload_size + PACKET_HEADER_SIZE + 1)}, checksumIndex{(uint8_t)(length - 1)},
-    sourceBridge{source_bridge}, controllerAssociation{controller_association} {
+    : length{(uint8_t)(payload_size + PACKET_HEADER_SIZE + 1)}, meta{static_cast<uint8_t>(source_bridge)} {
+  setControllerAssociation(controller_association);
+  setResponseExpected(true);
   memcpy(packetBytes, EMPTY_PACKET, length);
   packetBytes[PACKET_HEADER_INDEX_PACKET_TYPE] = static_cast<uint8_t>(packet_type);
   packetBytes[PACKET_HEADER_INDEX_PAYLOAD_LENGTH] = payload_size;
 
-  updateChecksum();
+  // The checksum is calculated by finalize(), once the packet has been filled in
+  meta |= META_CHECKSUM_STALE;
 }
 
 // Creates a packet with the provided bytes
 RawPacket::RawPacket(const uint8_t packet_bytes[], const uint8_t packet_length, SourceBridge source_bridge, ControllerAssociation controller_association)
-    : length{(uint8_t) packet_length}, checksumIndex{(uint8_t)(packet_length - 1)},
-    sourceBridge{source_bridge}, controllerAssociation{controller_association} {
+    : length{(uint8_t) packet_length}, meta{static_cast<uint8_t>(source_bridge)} {
+  setControllerAssociation(controller_association);
+  setResponseExpected(true);
   memcpy(packetBytes, packet_bytes, packet_length);
 
   if (!this->isChecksumValid()) {
@@ -27,31 +60,29 @@ RawPacket::RawPacket(const uint8_t packet_bytes[], const uint8_t packet_length,
   }
 }
 
-// Creates an empty RawPacket
-RawPacket::RawPacket() {
-  // TODO: Is this okay?
-}
-
 uint8_t RawPacket::calculateChecksum() const {
   uint8_t sum = 0;
-  for (int i = 0; i < checksumIndex; i++) {
+  for (int i = 0; i < checksumIndex(); i++) {
     sum += packetBytes[i];
   }
 
   return (0xfc - sum) & 0xff;
 }
 
-RawPacket &RawPacket::updateChecksum() {
-  packetBytes[checksumIndex] = calculateChecksum();
+RawPacket &RawPacket::finalize() {
+  if (length == 0 || !(meta & META_CHECKSUM_STALE)) return *this;
+  packetBytes[checksumIndex()] = calculateChecksum();
+  meta &= ~META_CHECKSUM_STALE;
   return *this;
 }
 
-bool RawPacket::isChecksumValid() const { return packetBytes[checksumIndex] == calculateChecksum(); }
+bool RawPacket::isChecksumValid() const {
+  return length > 0 && !(meta & META_CHECKSUM_STALE) && packetBytes[checksumIndex()] == calculateChecksum();
+}
 
-// Sets a payload byte and automatically updates the packet checksum
 RawPacket &RawPacket::setPayloadByte(const uint8_t payload_byte_index, const uint8_t value) {
   packetBytes[PACKET_HEADER_SIZE + payload_byte_index] = value;
-  updateChecksum();
+  meta |= META_CHECKSUM_STALE;
   return *this;
 }
 
@@ -3,6 +3,7 @@
 #include "esphome/core/component.h"
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/uart/uart.h"
+#include <cstdarg>
 #include <type_traits>
 
 namespace esphome {
@@ -17,6 +18,53 @@ const uint8_t PACKET_HEADER_INDEX_PACKET_TYPE = 1;
 const uint8_t PACKET_HEADER_INDEX_PAYLOAD_LENGTH = 4;
 
 
+// Large enough for the longest formatted packet (see Packet::format)
+static const size_t PACKET_FORMAT_BUFFER_SIZE = 512;
+
+/* Appends printf-style text to a caller-supplied buffer, truncating rather than overflowing.  Used to format packets
+for logging without touching the heap.
+*/
+class FormatBuffer {
+ public:
+  FormatBuffer(char *buffer, size_t size) : buffer_{buffer}, size_{size} {
+    if (size_ > 0) buffer_[0] = '\0';
+  }
+
+  void printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+  void put(char c);
+  // Appends a byte as two uppercase hex digits
+  void hex(uint8_t value);
+
+  const char *c_str() const { return buffer_; }
+  size_t length() const { return length_; }
+
+ private:
+  char *buffer_;
+  size_t size_;
+  size_t length_ = 0;
+};
+
+/* Logs a packet (anything with a formatPacket overload) after `message`, formatting it into a stack buffer.  The
+formatting is compiled out along with the log statement when the log level is disabled.
+*/
+#define MUART_LOG_PACKET_(log_macro, tag, message, packet) \
+  do { \
+    char muart_format_buffer_[PACKET_FORMAT_BUFFER_SIZE]; \
+    FormatBuffer muart_format_out_(muart_format_buffer_, sizeof(muart_format_buffer_)); \
+    formatPacket(muart_format_out_, packet); \
+    log_macro(tag, message "%s", muart_format_buffer_); \
+  } while (0)
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+#define MUART_LOGD_PACKET(tag, message, packet) MUART_LOG_PACKET_(ESP_LOGD, tag, message, packet)
+#else
+#define MUART_LOGD_PACKET(tag, message, packet) do {} while (0)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define MUART_LOGV_PACKET(tag, message, packet) MUART_LOG_PACKET_(ESP_LOGV, tag, message, packet)
+#else
+#define MUART_LOGV_PACKET(tag, message, packet) do {} while (0)
+#endif
+
 // TODO: Figure out something here so we don't have to static_cast<uint8_t> as much
 enum class PacketType : uint8_t {
   connect_request = 0x5a,
@@ -47,14 +95,14 @@ enum class SetCommand : uint8_t {
 };
 
 // Which MUARTBridge was the packet read from (used to determine flow direction of the packet)
-enum class SourceBridge {
+enum class SourceBridge : uint8_t {
   none,
   heatpump,
   thermostat
 };
 
 // Specifies which controller the packet "belongs" to (i.e. which controler created it either directly or via a request packet)
-enum class ControllerAssociation {
+enum class ControllerAssociation : uint8_t {
   muart,
   thermostat
 };
@@ -69,30 +117,47 @@ static const uint8_t EMPTY_PACKET[PACKET_MAX_SIZE] = {BYTE_CONTROL,        // Sy
 /* A class representing the raw packet sent to or from the Mitsubishi equipment with definitions
 for header indexes, checksum calculations, utility methods, etc.  These generally shouldn't be accessed
 directly outside the MUARTBridge, and the Packet class (or its subclasses) should be used instead.
+
+A RawPacket is plain data (no vtable, trivially copyable): the frame bytes, their length, and one byte of
+metadata.  It's what every queue, cache and pool slot stores, so its size is fixed by the static_asserts below.
 */
 class RawPacket {
  public:
   RawPacket(const uint8_t packet_bytes[], const uint8_t packet_length, SourceBridge source_bridge = SourceBridge::none, ControllerAssociation controller_association=ControllerAssociation::muart);  // For reading or copying packets
-  // TODO: Can I hide this constructor except from optional?
-  RawPacket(); // For optional<RawPacket> construction
+  RawPacket() = default;  // An empty frame, for pool slots and optional<>
   RawPacket(PacketType packet_type, uint8_t payload_size, SourceBridge source_bridge = SourceBridge::none, ControllerAssociation controller_association=ControllerAssociation::muart);  // For building packets
-  virtual ~RawPacket() {}
-
-  virtual std::string to_string() const {return format_hex_pretty(&getBytes()[0], getLength());};
 
   uint8_t getLength() const { return length; };
   const uint8_t *getBytes() const { return packetBytes; };  // Primarily for sending packets
 
+  // False for a frame that has been changed but not yet finalized
   bool isChecksumValid() const;
+  // Recalculates the checksum if the frame has been changed since it was last calculated.  Building a packet only
+  // sets payload bytes, so its checksum is calculated once, here (the bridges finalize every frame they queue).
+  RawPacket &finalize();
 
   // Returns the packet type byte
   uint8_t getPacketType() const { return packetBytes[PACKET_HEADER_INDEX_PACKET_TYPE]; };
   // Returns the first byte of the payload, often used as a command
   uint8_t getCommand() const { return getPayloadByte(PLINDEX_COMMAND); };
 
-  SourceBridge getSourceBridge() const { return sourceBridge; };
-  ControllerAssociation getControllerAssociation() const { return controllerAssociation; };
+  SourceBridge getSourceBridge() const { return static_cast<SourceBridge>(meta & META_SOURCE_MASK); };
+  ControllerAssociation getControllerAssociation() const {
+    return (meta & META_THERMOSTAT) ? ControllerAssociation::thermostat : ControllerAssociation::muart;
+  };
+  void setControllerAssociation(ControllerAssociation controller_association) {
+    setMeta(META_THERMOSTAT, controller_association == ControllerAssociation::thermostat);
+  };
+
+  // Set once the frame has been forwarded to the other bridge, so it isn't routed a second time
+  bool isForwarded() const { return meta & META_FORWARDED; };
+  void setForwarded(bool value = true) { setMeta(META_FORWARDED, value); };
+
+  // Whether a response is expected when this frame is sent (see Packet::isResponseExpected)
+  bool isResponseExpected() const { return meta & META_RESPONSE_EXPECTED; };
+  void setResponseExpected(bool value) { setMeta(META_RESPONSE_EXPECTED, value); };
 
+  // Sets a payload byte, leaving the checksum to finalize()
   RawPacket &setPayloadByte(const uint8_t payload_byte_index, const uint8_t value);
   uint8_t getPayloadByte(const uint8_t payload_byte_index) const {
       return packetBytes[PACKET_HEADER_SIZE + payload_byte_index];
@@ -101,16 +166,29 @@ class RawPacket {
  private:
   static const int PLINDEX_COMMAND = 0;
 
-  uint8_t packetBytes[PACKET_MAX_SIZE]{};
-  uint8_t length;
-  uint8_t checksumIndex;
+  // Layout of the metadata byte
+  static const uint8_t META_SOURCE_MASK = 0x03;  // SourceBridge
+  static const uint8_t META_THERMOSTAT = 0x04;  // ControllerAssociation::thermostat (clear for muart)
+  static const uint8_t META_FORWARDED = 0x08;
+  static const uint8_t META_RESPONSE_EXPECTED = 0x10;
+  static const uint8_t META_CHECKSUM_STALE = 0x20;  // Changed since the checksum was calculated
+
+  void setMeta(uint8_t bit, bool value) { meta = value ? (meta | bit) : (meta & ~bit); }
 
-  SourceBridge sourceBridge;
-  ControllerAssociation controllerAssociation;
+  uint8_t packetBytes[PACKET_MAX_SIZE]{};
+  uint8_t length = 0;
+  uint8_t meta = META_RESPONSE_EXPECTED;
 
+  // The checksum is always the last byte of the frame
+  uint8_t checksumIndex() const { return length - 1; }
   uint8_t calculateChecksum() const;
-  RawPacket &updateChecksum();
 };
 
+static_assert(std::is_trivially_copyable<RawPacket>::value, "RawPacket must stay plain data");
+static_assert(sizeof(RawPacket) == PACKET_MAX_SIZE + 2, "RawPacket should be the frame bytes, length and metadata");
+
+// Writes the frame as dotted hex
+void formatPacket(FormatBuffer &out, const RawPacket &frame);
+
 }  // namespace mitsubishi_uart
 }  // namespace esphome
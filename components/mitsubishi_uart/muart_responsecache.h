@@ -0,0 +1,75 @@
+#pragma once
+
+#include "muart_framepool.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// Number of different get commands the response cache can hold
+static const size_t RESPONSE_CACHE_SIZE = 8;
+
+/* Keeps the most recent get response frame seen from the heatpump for each get command, along with when it was
+received.  Used to answer thermostat get requests without going to the heatpump, and to tell how fresh our view of
+each kind of data is regardless of who asked for it.
+*/
+class ResponseCache {
+ public:
+  void store(const FrameHandle &response, uint32_t now) {
+    // The pool's overflow frame is overwritten by the next frame acquired, so it can't be kept
+    if (response.isOverflow()) return;
+    Entry *entry = find(response->getCommand());
+    if (!entry) {
+      // Not seen before; take a free slot, or replace the least recently updated
+      entry = &entries[0];
+      for (Entry &e : entries) {
+        if (!e.packet) {
+          entry = &e;
+          break;
+        }
+        if (now - e.receivedMillis > now - entry->receivedMillis) entry = &e;
+      }
+    }
+    entry->packet = response;
+    entry->receivedMillis = now;
+  }
+
+  // Cached response for the get command if one is no older than max_age_ms, or nullptr
+  const RawPacket *lookup(uint8_t command, uint32_t now, uint32_t max_age_ms) const {
+    const Entry *entry = find(command);
+    if (!entry || now - entry->receivedMillis > max_age_ms) return nullptr;
+    return &*entry->packet;
+  }
+
+  // Forgets the response to the get command (e.g. because a set request has made it stale)
+  void invalidate(uint8_t command) {
+    if (Entry *entry = find(command)) *entry = Entry{};
+  }
+  void clear() {
+    for (Entry &e : entries) e = Entry{};
+  }
+
+  // Milliseconds since a response to the get command was last seen, or UINT32_MAX if never
+  uint32_t age(uint8_t command, uint32_t now) const {
+    const Entry *entry = find(command);
+    return entry ? now - entry->receivedMillis : UINT32_MAX;
+  }
+
+ private:
+  struct Entry {
+    FrameHandle packet;  // Shares the received frame rather than copying it
+    uint32_t receivedMillis = 0;
+  };
+
+  Entry *find(uint8_t command) {
+    for (Entry &e : entries) {
+      if (e.packet && e.packet->getCommand() == command) return &e;
+    }
+    return nullptr;
+  }
+  const Entry *find(uint8_t command) const { return const_cast<ResponseCache *>(this)->find(command); }
+
+  Entry entries[RESPONSE_CACHE_SIZE];
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+/* A fixed-capacity FIFO ring buffer.  All storage is allocated inline with the object, so pushing and
+popping never touches the heap.  Items are copied in and out by value, so T should be cheap to copy.
+*/
+template<typename T, size_t N> class RingBuffer {
+ public:
+  static_assert(N > 0, "RingBuffer capacity must be greater than zero");
+
+  bool empty() const { return count_ == 0; }
+  bool full() const { return count_ == N; }
+  size_t size() const { return count_; }
+  static constexpr size_t capacity() { return N; }
+
+  // Adds an item to the back of the buffer.  Returns false (and does nothing) if the buffer is full.
+  bool push(const T &item) {
+    if (full()) return false;
+    items_[(head_ + count_) % N] = item;
+    count_++;
+    return true;
+  }
+
+  // Oldest item in the buffer.  Only valid if the buffer is not empty.
+  T &front() { return items_[head_]; }
+  const T &front() const { return items_[head_]; }
+
+  // Removes the oldest item (resetting its storage, so anything it refers to is released).  Does nothing if the
+  // buffer is empty.
+  void pop() {
+    if (empty()) return;
+    items_[head_] = T{};
+    head_ = (head_ + 1) % N;
+    count_--;
+  }
+
+  // Access by position, where 0 is the oldest item.  Index must be less than size().
+  T &at(size_t index) { return items_[(head_ + index) % N]; }
+  const T &at(size_t index) const { return items_[(head_ + index) % N]; }
+
+  void clear() {
+    for (T &item : items_) item = T{};
+    head_ = 0;
+    count_ = 0;
+  }
+
+ private:
+  T items_[N]{};
+  size_t head_ = 0;
+  size_t count_ = 0;
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
@@ -0,0 +1,88 @@
+#include "muart_schema.h"
+#include "muart_utils.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+static uint8_t maskShift(uint8_t mask) {
+  uint8_t shift = 0;
+  while (mask != 0 && !(mask & 0x01)) {
+    mask >>= 1;
+    shift++;
+  }
+  return shift;
+}
+
+uint16_t readField(const RawPacket &frame, const PacketField &field) {
+  if (field.width == 2) {
+    return frame.getPayloadByte(field.index) << 8 | frame.getPayloadByte(field.index + 1);
+  }
+  return (frame.getPayloadByte(field.index) & field.mask) >> maskShift(field.mask);
+}
+
+void writeField(RawPacket &frame, const PacketField &field, const uint16_t value) {
+  if (field.width == 2) {
+    frame.setPayloadByte(field.index, value >> 8);
+    frame.setPayloadByte(field.index + 1, value & 0xff);
+    return;
+  }
+  const uint8_t shifted = (value << maskShift(field.mask)) & field.mask;
+  frame.setPayloadByte(field.index, (frame.getPayloadByte(field.index) & ~field.mask) | shifted);
+}
+
+float readTemperature(const RawPacket &frame, const PacketField &field) {
+  const uint8_t value = readField(frame, field);
+  switch (field.scale) {
+    case FieldScale::temp_scale_a:
+      return MUARTUtils::TempScaleAToDegC(value);
+    case FieldScale::legacy_target_temp:
+      return MUARTUtils::LegacyTargetTempToDegC(value);
+    case FieldScale::legacy_room_temp:
+      return MUARTUtils::LegacyRoomTempToDegC(value);
+    default:
+      return value;
+  }
+}
+
+void writeTemperature(RawPacket &frame, const PacketField &field, const float degreesC) {
+  switch (field.scale) {
+    case FieldScale::temp_scale_a:
+      writeField(frame, field, MUARTUtils::DegCToTempScaleA(degreesC));
+      break;
+    case FieldScale::legacy_target_temp:
+      writeField(frame, field, MUARTUtils::DegCToLegacyTargetTemp(degreesC));
+      break;
+    case FieldScale::legacy_room_temp:
+      writeField(frame, field, MUARTUtils::DegCToLegacyRoomTemp(degreesC));
+      break;
+    default:
+      writeField(frame, field, degreesC);
+      break;
+  }
+}
+
+void formatField(FormatBuffer &out, const RawPacket &frame, const PacketField &field) {
+  switch (field.scale) {
+    case FieldScale::flag:
+      out.printf(" %s:%s", field.name, readField(frame, field) ? "Yes" : "No");
+      break;
+    case FieldScale::number:
+      out.printf(" %s:%u", field.name, readField(frame, field));
+      break;
+    case FieldScale::temp_scale_a:
+    case FieldScale::legacy_target_temp:
+    case FieldScale::legacy_room_temp:
+      out.printf(" %s:%.1f", field.name, readTemperature(frame, field));
+      break;
+    default:
+      if (field.width == 2) {
+        out.printf(" %s:%04x", field.name, readField(frame, field));
+      } else {
+        out.printf(" %s:%02x", field.name, readField(frame, field));
+      }
+      break;
+  }
+}
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
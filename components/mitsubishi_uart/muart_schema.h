@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include "muart_rawpacket.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// How a payload field's raw value is interpreted
+enum class FieldScale : uint8_t {
+  raw,                 // The value as-is (a code, shown in hex)
+  number,              // The value as-is (a quantity, shown in decimal)
+  flag,                // True if any of the field's bits are set
+  temp_scale_a,        // Temperature in 0.5C steps offset by 128 (see MUARTUtils::TempScaleAToDegC)
+  legacy_target_temp,  // Setpoint in the older 16-31.5C encoding
+  legacy_room_temp,    // Room temperature in the older 10-41C encoding
+};
+
+/* One field of a packet's payload.  Multi-byte fields are big-endian and always use whole bytes; single-byte fields
+can use some of the bits of a byte (mask), in which case the value is shifted down to the lowest set bit of the mask.
+*/
+struct PacketField {
+  const char *name;  // As shown when the packet is logged
+  uint8_t index;     // First payload byte
+  uint8_t width;     // In bytes (1 or 2)
+  uint8_t mask;
+  FieldScale scale;
+  uint16_t setFlags;  // For set requests, the bits of the flags (low byte) and flags2 (high byte) marking it as set
+};
+
+constexpr PacketField byteField(const char *name, uint8_t index, FieldScale scale = FieldScale::raw,
+                                uint16_t setFlags = 0) {
+  return PacketField{name, index, 1, 0xff, scale, setFlags};
+}
+constexpr PacketField wordField(const char *name, uint8_t index) {
+  return PacketField{name, index, 2, 0xff, FieldScale::raw, 0};
+}
+constexpr PacketField bitField(const char *name, uint8_t index, uint8_t mask) {
+  return PacketField{name, index, 1, mask, FieldScale::flag, 0};
+}
+
+// Payload bytes holding the set request flags
+static const uint8_t PLINDEX_SET_FLAGS = 1;
+static const uint8_t PLINDEX_SET_FLAGS2 = 2;
+
+uint16_t readField(const RawPacket &frame, const PacketField &field);
+// Writes the bits of a field, leaving the rest of its bytes alone.  The checksum is left for RawPacket::finalize().
+void writeField(RawPacket &frame, const PacketField &field, uint16_t value);
+// Decodes a temperature field (using its scale) to degrees C
+float readTemperature(const RawPacket &frame, const PacketField &field);
+// Encodes degrees C into a temperature field (using its scale, which clamps out of range values)
+void writeTemperature(RawPacket &frame, const PacketField &field, float degreesC);
+// Appends " Name:value" for the field, decoded according to its scale
+void formatField(FormatBuffer &out, const RawPacket &frame, const PacketField &field);
+
+// The set request flags of a frame, flags2 in the high byte
+inline uint16_t readSetFlags(const RawPacket &frame) {
+  return frame.getPayloadByte(PLINDEX_SET_FLAGS) | frame.getPayloadByte(PLINDEX_SET_FLAGS2) << 8;
+}
+
+/* The fields making up a packet class's payload, checked at compile time (see the static_asserts next to each
+schema): every field has to fit in the payload, and no two fields can share a bit.  Accessors read and write through
+the fields, and the schema formats them for logging.
+*/
+template<size_t N> class PacketSchema {
+ public:
+  constexpr PacketSchema(uint8_t payload_size, const std::array<PacketField, N> &packet_fields)
+      : payloadSize{payload_size}, fields{packet_fields} {}
+
+  constexpr bool fitsPayload() const {
+    for (size_t i = 0; i < N; i++) {
+      if (fields[i].width == 0 || fields[i].index + fields[i].width > payloadSize) return false;
+    }
+    return true;
+  }
+
+  constexpr bool hasOverlaps() const {
+    for (size_t i = 0; i < N; i++) {
+      for (size_t j = i + 1; j < N; j++) {
+        if (overlap(fields[i], fields[j])) return true;
+      }
+    }
+    return false;
+  }
+
+  void format(FormatBuffer &out, const RawPacket &frame) const {
+    for (const PacketField &field : fields) formatField(out, frame, field);
+  }
+
+  const uint8_t payloadSize;
+  const std::array<PacketField, N> fields;
+
+ private:
+  static constexpr bool overlap(const PacketField &a, const PacketField &b) {
+    return a.index < b.index + b.width && b.index < a.index + a.width && (a.mask & b.mask) != 0;
+  }
+};
+
+template<typename... F> constexpr PacketSchema<sizeof...(F)> makeSchema(uint8_t payload_size, F... fields) {
+  return PacketSchema<sizeof...(F)>(payload_size, std::array<PacketField, sizeof...(F)>{{fields...}});
+}
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
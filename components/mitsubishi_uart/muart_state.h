@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// Each published entity has a dirty bit in HeatpumpState
+enum class StateField : uint8_t {
+  climate,  // Mode, temperatures, fan and action, which are held by the climate entity itself
+  vane,
+  horizontal_vane,
+  thermostat_temperature,
+  compressor_frequency,
+  actual_fan,
+  service_filter,
+  defrost,
+  hot_adjust,
+  standby,
+  error_code,
+  count
+};
+
+static_assert(static_cast<size_t>(StateField::count) <= 16, "HeatpumpState dirty bits are a uint16_t");
+
+/* Everything decoded from the equipment that gets published, other than what the climate entity already holds.  The
+packet handlers write values here with update(), which marks a field dirty if it changed (or has never been
+published); doPublish() then publishes only the dirty fields and clears them.
+*/
+struct HeatpumpState {
+  float thermostatTemperature = NAN;
+  uint16_t errorCode = 0x8000;  // 0x8000 is "no error"
+  uint8_t errorShortCode = 0;
+  uint8_t compressorFrequency = 0;
+  uint8_t actualFanSpeed = 0;  // Index into ACTUAL_FAN_SPEED_NAMES
+  uint8_t vane = 0;  // SettingsSetRequestPacket::VANE_*
+  uint8_t horizontalVane = 0;  // SettingsSetRequestPacket::HV_*
+  bool serviceFilter = false;
+  bool defrost = false;
+  bool hotAdjust = false;
+  bool standby = false;
+
+  // Stores a value, marking its field dirty if it differs from the last value or hasn't been published yet
+  template<typename T> void update(StateField field, T &value, const typename std::common_type<T>::type newValue) {
+    if (value == newValue && (published & bit(field))) return;
+    value = newValue;
+    markDirty(field);
+  }
+  void markDirty(StateField field) { dirty |= bit(field); }
+
+  bool isDirty(StateField field) const { return dirty & bit(field); }
+  bool anyDirty() const { return dirty != 0; }
+  // Called once the dirty fields have been published
+  void clearDirty() {
+    published |= dirty;
+    dirty = 0;
+  }
+
+ private:
+  static uint16_t bit(StateField field) { return 1 << static_cast<uint8_t>(field); }
+
+  uint16_t dirty = 0;
+  uint16_t published = 0;  // Fields that have been published at least once
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
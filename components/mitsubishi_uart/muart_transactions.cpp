@@ -0,0 +1,94 @@
+#include "muart_transactions.h"
+#include <algorithm>
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+void ResponseTimeEstimator::addSample(const uint32_t rttMillis) {
+  if (!hasSample) {
+    srttMillis = rttMillis;
+    rttVarMillis = rttMillis / 2;
+    hasSample = true;
+  } else {
+    const uint32_t delta = srttMillis > rttMillis ? srttMillis - rttMillis : rttMillis - srttMillis;
+    rttVarMillis = (3 * rttVarMillis + delta) / 4;
+    srttMillis = (7 * srttMillis + rttMillis) / 8;
+  }
+  timeoutMillis = std::max(MIN_RESPONSE_TIMEOUT_MS, std::min(MAX_RESPONSE_TIMEOUT_MS, srttMillis + 4 * rttVarMillis));
+}
+
+void TransactionTable::add(const FrameHandle &request, const uint32_t now, const uint32_t timeout_ms,
+                           const uint8_t retries) {
+  if (count == MAX_TRANSACTIONS) {
+    remove(0);
+  }
+  transactions[count++] = Transaction{request, now, now, timeout_ms, retries, 1, false};
+}
+
+bool TransactionTable::matches(const Transaction &txn, const RawPacket &response) {
+  if (response.getPacketType() != (txn.requestType() | RESPONSE_TYPE_BIT)) return false;
+
+  // Only get and set packets carry a meaningful command byte
+  if (txn.requestType() == static_cast<uint8_t>(PacketType::get_request) ||
+      txn.requestType() == static_cast<uint8_t>(PacketType::set_request)) {
+    return response.getCommand() == txn.command();
+  }
+  return true;
+}
+
+// Transactions are stored oldest first, and responses arrive in order, so the oldest match wins
+optional<Transaction> TransactionTable::match(const RawPacket &response) {
+  for (size_t i = 0; i < count; i++) {
+    if (matches(transactions[i], response)) {
+      Transaction txn = transactions[i];
+      remove(i);
+      return txn;
+    }
+  }
+  return nullopt;
+}
+
+bool TransactionTable::hasLive() const { return live() != nullptr; }
+
+bool TransactionTable::hasLive(const uint8_t requestType, const uint8_t command) const {
+  const Transaction *txn = live();
+  return txn != nullptr && txn->requestType() == requestType && txn->command() == command;
+}
+
+const Transaction *TransactionTable::live() const {
+  for (size_t i = 0; i < count; i++) {
+    if (!transactions[i].timedOut) return &transactions[i];
+  }
+  return nullptr;
+}
+
+Transaction *TransactionTable::overdue(const uint32_t now) {
+  for (size_t i = 0; i < count; i++) {
+    Transaction &txn = transactions[i];
+    if (!txn.timedOut && now - txn.sentMillis > txn.timeoutMillis) return &txn;
+  }
+  return nullptr;
+}
+
+void TransactionTable::expire(const uint32_t now) {
+  size_t i = 0;
+  while (i < count) {
+    const Transaction &txn = transactions[i];
+    if (txn.timedOut && now - txn.sentMillis > txn.timeoutMillis + lateResponseGraceMillis) {
+      remove(i);
+      continue;
+    }
+    i++;
+  }
+}
+
+void TransactionTable::remove(const size_t index) {
+  for (size_t i = index; i + 1 < count; i++) {
+    transactions[i] = transactions[i + 1];
+  }
+  // Releases the request frame held by the vacated entry
+  transactions[--count] = Transaction{};
+}
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
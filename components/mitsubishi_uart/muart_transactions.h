@@ -0,0 +1,94 @@
+#pragma once
+
+#include "muart_framepool.h"
+
+namespace esphome {
+namespace mitsubishi_uart {
+
+// Maximum number of outstanding requests tracked at once (one live request plus any timed-out ones in their grace window)
+static const size_t MAX_TRANSACTIONS = 4;
+
+// Bounds for the adaptive response timeout
+static const uint32_t MIN_RESPONSE_TIMEOUT_MS = 300;
+static const uint32_t MAX_RESPONSE_TIMEOUT_MS = 3000;
+// Upper limit on the timeout after backing off for retries
+static const uint32_t MAX_BACKOFF_TIMEOUT_MS = 8000;
+
+// A request sent to the heatpump that expects a response
+struct Transaction {
+  FrameHandle request;  // Kept so the request can be retried
+  uint32_t firstSentMillis;
+  uint32_t sentMillis;  // When the latest attempt was sent
+  uint32_t timeoutMillis;  // How long to wait for this attempt
+  uint8_t retriesLeft;
+  uint8_t attempts;  // Number of times the request has been sent
+  bool timedOut;     // No longer blocking new requests, but a late response will still be accepted
+
+  uint8_t requestType() const { return request->getPacketType(); }
+  uint8_t command() const { return request->getCommand(); }
+  ControllerAssociation controllerAssociation() const { return request->getControllerAssociation(); }
+};
+
+/* Estimates how long to wait for a response from observed round trip times, the same way TCP calculates its
+retransmission timeout (RFC 6298): a smoothed round trip time plus four times its variance, clamped between
+MIN_RESPONSE_TIMEOUT_MS and MAX_RESPONSE_TIMEOUT_MS.  Until a sample is taken, the maximum is used.
+*/
+class ResponseTimeEstimator {
+ public:
+  void addSample(uint32_t rttMillis);
+  uint32_t getTimeout() const { return timeoutMillis; }
+  uint32_t getSmoothedRtt() const { return srttMillis; }
+
+ private:
+  uint32_t srttMillis = 0;
+  uint32_t rttVarMillis = 0;
+  uint32_t timeoutMillis = MAX_RESPONSE_TIMEOUT_MS;
+  bool hasSample = false;
+};
+
+/* Correlates responses from the heatpump with the requests that caused them, so responses can be attributed to the
+controller (MUART or thermostat) that asked for them.  A response matches a request if its packet type is the response
+type for the request (e.g. get_response 0x62 for get_request 0x42) and, for get and set packets, the command byte
+matches.  Requests that time out are kept for a grace window so that late responses are still routed correctly.
+*/
+class TransactionTable {
+ public:
+  TransactionTable(uint32_t late_response_grace_ms) : lateResponseGraceMillis{late_response_grace_ms} {}
+
+  // Records a sent request.  If the table is full, the oldest entry is dropped to make room.
+  void add(const FrameHandle &request, uint32_t now, uint32_t timeout_ms, uint8_t retries);
+
+  // Finds and removes the transaction this response belongs to, if any
+  optional<Transaction> match(const RawPacket &response);
+
+  // Returns true if a request is outstanding and hasn't timed out (i.e. we should wait before sending)
+  bool hasLive() const;
+  // Returns true if a live request of this type and command is outstanding
+  bool hasLive(uint8_t requestType, uint8_t command) const;
+  // The live request, if any
+  const Transaction *live() const;
+
+  // The live request if it has waited longer than its timeout, otherwise nullptr.  The caller should either retry
+  // it or mark it as timed out.
+  Transaction *overdue(uint32_t now);
+
+  // Drops timed-out requests whose grace window has passed
+  void expire(uint32_t now);
+
+  // True if this packet type is a response to some request type
+  static bool isResponse(uint8_t packetType) { return packetType & RESPONSE_TYPE_BIT; }
+
+ private:
+  // Response packet types are the request type with this bit set
+  static const uint8_t RESPONSE_TYPE_BIT = 0x20;
+
+  static bool matches(const Transaction &txn, const RawPacket &response);
+  void remove(size_t index);
+
+  Transaction transactions[MAX_TRANSACTIONS];
+  size_t count = 0;
+  uint32_t lateResponseGraceMillis;
+};
+
+}  // namespace mitsubishi_uart
+}  // namespace esphome
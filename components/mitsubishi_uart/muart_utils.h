@@ -1,6 +1,9 @@
 #pragma once
 
-#include "mitsubishi_uart.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 
 namespace esphome {
 namespace mitsubishi_uart {
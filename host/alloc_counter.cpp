@@ -0,0 +1,28 @@
+#include "alloc_counter.h"
+#include <cstdlib>
+#include <new>
+
+// Only linked into the benchmarks, which report allocations per frame
+
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  allocatedBytes += size;
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace esphome {
+namespace host {
+
+AllocationCount allocationCount() { return AllocationCount{allocations, allocatedBytes}; }
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace host {
+
+// Heap allocations made by the process so far (counted by the operator new in alloc_counter.cpp)
+struct AllocationCount {
+  uint64_t allocations;
+  uint64_t bytes;
+};
+AllocationCount allocationCount();
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "alloc_counter.h"
+#include "host.h"
+#include "muart_rawpacket.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+/* Shared by the benchmarks: `--count N` sets how many items (frames, packets...) each case runs, so ctest can run a
+quick pass and a real measurement can run a long one.  Results are printed one case per line.
+*/
+inline uint64_t benchCount(int argc, char **argv, uint64_t fallback) {
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--count") == 0) return strtoull(argv[i + 1], nullptr, 10);
+  }
+  return fallback;
+}
+
+// Benchmarks don't print the component's logs, unless asked to with MUART_HOST_LOG_LEVEL
+inline void quietLogs() {
+  if (!getenv("MUART_HOST_LOG_LEVEL")) setLogLevel(ESPHOME_LOG_LEVEL_NONE);
+}
+
+// Times a case and counts its allocations
+class BenchCase {
+ public:
+  explicit BenchCase(const char *name) : name{name} {}
+
+  void start() {
+    allocationsAtStart = allocationCount();
+    started = std::chrono::steady_clock::now();
+  }
+  void stop(uint64_t items) {
+    const auto elapsed = std::chrono::steady_clock::now() - started;
+    const AllocationCount allocations = allocationCount();
+    count = items;
+    nanos = std::chrono::duration<double, std::nano>(elapsed).count();
+    allocated.allocations = allocations.allocations - allocationsAtStart.allocations;
+    allocated.bytes = allocations.bytes - allocationsAtStart.bytes;
+  }
+
+  double nanosPerItem() const { return count ? nanos / count : 0; }
+  double itemsPerSecond() const { return nanos > 0 ? count * 1e9 / nanos : 0; }
+  double allocationsPerItem() const { return count ? static_cast<double>(allocated.allocations) / count : 0; }
+  double allocatedBytesPerItem() const { return count ? static_cast<double>(allocated.bytes) / count : 0; }
+
+  // Prints the case, with any extra per-item figures appended (e.g. "bytes copied/frame")
+  void print(const char *unit, const std::string &extra = "") const {
+    printf("%-44s %10llu %-7s %10.1f ns/%-7s %12.0f %s/s %8.2f allocs/%s %9.1f B/%s%s%s\n", name,
+           static_cast<unsigned long long>(count), unit, nanosPerItem(), unit, itemsPerSecond(), unit,
+           allocationsPerItem(), unit, allocatedBytesPerItem(), unit, extra.empty() ? "" : "  ", extra.c_str());
+  }
+
+ private:
+  const char *name;
+  std::chrono::steady_clock::time_point started;
+  AllocationCount allocationsAtStart{};
+  AllocationCount allocated{};
+  uint64_t count = 0;
+  double nanos = 0;
+};
+
+// The bytes of a frame, with its checksum calculated
+inline std::vector<uint8_t> frameBytes(mitsubishi_uart::RawPacket frame) {
+  frame.finalize();
+  return std::vector<uint8_t>(frame.getBytes(), frame.getBytes() + frame.getLength());
+}
+
+}  // namespace host
+}  // namespace esphome
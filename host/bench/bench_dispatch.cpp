@@ -0,0 +1,252 @@
+#include "bench.h"
+#include "legacy.h"
+#include "muart_bridge.h"
+#include "muart_dispatch.h"
+
+/* Cost of classifying a received frame and handing it to the processor as the right packet class.
+
+The "switch" case is the original classifyAndProcessRawPacket: a switch on the packet type with nested switches on the
+command, each case moving the frame into a by-value packet of its class.  The "PACKET_DISPATCH" case is the current
+bridge code (MUARTBridge::isResponseExpected and classifyAndProcessRawPacket, through the compile-time hash table).
+Both run over every frame kind the component registers, plus unregistered commands.
+
+The table cases look up every key of synthetic tables of increasing size, to show that the lookup doesn't grow with
+the number of registered packet classes.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+uint64_t sink = 0;
+
+std::vector<RawPacket> frameMix() {
+  struct Kind {
+    PacketType type;
+    uint8_t command;
+    uint8_t payloadSize;
+  };
+  const Kind kinds[] = {
+      {PacketType::connect_request, 0xca, 2},
+      {PacketType::connect_response, 0x00, 1},
+      {PacketType::extended_connect_request, 0xc9, 1},
+      {PacketType::extended_connect_response, 0xc9, 16},
+      {PacketType::get_request, static_cast<uint8_t>(GetCommand::settings), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::settings), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::current_temp), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::error_info), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::standby), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::status), 16},
+      {PacketType::get_response, static_cast<uint8_t>(GetCommand::a_9), 16},
+      {PacketType::get_response, 0x05, 16},
+      {PacketType::set_request, static_cast<uint8_t>(SetCommand::remote_temperature), 16},
+      {PacketType::set_request, static_cast<uint8_t>(SetCommand::settings), 16},
+      {PacketType::set_request, static_cast<uint8_t>(SetCommand::thermostat_hello), 16},
+      {PacketType::set_request, 0x08, 16},
+      {PacketType::set_response, static_cast<uint8_t>(SetCommand::remote_temperature), 16},
+      {PacketType::set_response, static_cast<uint8_t>(SetCommand::settings), 16},
+  };
+  std::vector<RawPacket> frames;
+  for (const Kind &kind : kinds) {
+    RawPacket frame(kind.type, kind.payloadSize, SourceBridge::thermostat, ControllerAssociation::thermostat);
+    frame.setPayloadByte(0, kind.command).finalize();
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+////
+// Original: nested switches
+////
+
+class LegacyProcessor {
+ public:
+  virtual ~LegacyProcessor() = default;
+  virtual void processPacket(int packetClass, const legacy::Packet &packet) {
+    sink += packetClass + packet.isResponseExpected();
+  }
+};
+
+template<int PacketClass>
+void legacyProcess(legacy::RawPacket &pkt, bool expectResponse, LegacyProcessor &processor) {
+  legacy::Packet packet = legacy::Packet(std::move(pkt));
+  packet.setResponseExpected(expectResponse);
+  processor.processPacket(PacketClass, packet);
+}
+
+void legacyClassifyAndProcess(legacy::RawPacket &pkt, LegacyProcessor &processor) {
+  switch (static_cast<PacketType>(pkt.getPacketType())) {
+    case PacketType::connect_request:
+      legacyProcess<1>(pkt, true, processor);
+      break;
+    case PacketType::connect_response:
+      legacyProcess<2>(pkt, false, processor);
+      break;
+    case PacketType::extended_connect_request:
+      legacyProcess<3>(pkt, true, processor);
+      break;
+    case PacketType::extended_connect_response:
+      legacyProcess<4>(pkt, false, processor);
+      break;
+    case PacketType::get_request:
+      legacyProcess<5>(pkt, true, processor);
+      break;
+    case PacketType::get_response:
+      switch (static_cast<GetCommand>(pkt.getCommand())) {
+        case GetCommand::settings:
+          legacyProcess<6>(pkt, false, processor);
+          break;
+        case GetCommand::current_temp:
+          legacyProcess<7>(pkt, false, processor);
+          break;
+        case GetCommand::error_info:
+          legacyProcess<8>(pkt, false, processor);
+          break;
+        case GetCommand::standby:
+          legacyProcess<9>(pkt, false, processor);
+          break;
+        case GetCommand::status:
+          legacyProcess<10>(pkt, false, processor);
+          break;
+        case GetCommand::a_9:
+          legacyProcess<11>(pkt, false, processor);
+          break;
+        default:
+          legacyProcess<0>(pkt, false, processor);
+      }
+      break;
+    case PacketType::set_request:
+      switch (static_cast<SetCommand>(pkt.getCommand())) {
+        case SetCommand::remote_temperature:
+          legacyProcess<12>(pkt, true, processor);
+          break;
+        case SetCommand::settings:
+          legacyProcess<13>(pkt, true, processor);
+          break;
+        case SetCommand::thermostat_hello:
+          legacyProcess<14>(pkt, false, processor);
+          break;
+        default:
+          legacyProcess<0>(pkt, true, processor);
+      }
+      break;
+    case PacketType::set_response:
+      switch (static_cast<SetCommand>(pkt.getCommand())) {
+        case SetCommand::remote_temperature:
+          legacyProcess<15>(pkt, false, processor);
+          break;
+        default:
+          legacyProcess<0>(pkt, false, processor);
+      }
+      break;
+    default:
+      legacyProcess<0>(pkt, true, processor);
+  }
+}
+
+void benchLegacy(const std::vector<RawPacket> &mix, uint64_t frames) {
+  std::vector<legacy::RawPacket> legacyMix;
+  for (const RawPacket &frame : mix) legacyMix.emplace_back(frame.getBytes(), frame.getLength());
+  LegacyProcessor processor;
+
+  BenchCase bench("switch + by-value packets (original)");
+  bench.start();
+  for (uint64_t i = 0; i < frames; i++) {
+    // Each received frame was a fresh copy
+    legacy::RawPacket pkt = legacyMix[i % legacyMix.size()];
+    legacyClassifyAndProcess(pkt, processor);
+  }
+  bench.stop(frames);
+  bench.print("frame");
+}
+
+////
+// Current: the bridge's dispatch table
+////
+
+class CountingProcessor : public PacketProcessor {
+ public:
+  void processPacket(const Packet &packet) override { sink += packet.getPacketType(); }
+  void processPacket(const SettingsGetResponsePacket &packet) override { sink += packet.getPower(); }
+  void processPacket(const CurrentTempGetResponsePacket &packet) override { sink += packet.getPacketType(); }
+};
+
+class DispatchingBridge : public HeatpumpBridge {
+ public:
+  using HeatpumpBridge::HeatpumpBridge;
+
+  void receive(const FrameHandle &frame) {
+    frame->setResponseExpected(isResponseExpected(*frame));
+    classifyAndProcessRawPacket(frame);
+  }
+};
+
+class IdleUART : public uart::UARTComponent {
+ public:
+  void write_array(const uint8_t *, size_t) override {}
+  bool peek_byte(uint8_t *) override { return false; }
+  bool read_array(uint8_t *, size_t) override { return false; }
+  int available() override { return 0; }
+  void flush() override {}
+};
+
+void benchTable(const std::vector<RawPacket> &mix, uint64_t frames) {
+  IdleUART uart;
+  CountingProcessor processor;
+  DispatchingBridge bridge(&uart, &processor);
+  std::vector<FrameHandle> handles;
+  for (const RawPacket &frame : mix) handles.push_back(framePool().acquire(frame));
+
+  BenchCase bench("PACKET_DISPATCH + frame handles");
+  bench.start();
+  for (uint64_t i = 0; i < frames; i++) bridge.receive(handles[i % handles.size()]);
+  bench.stop(frames);
+  bench.print("frame");
+}
+
+////
+// Lookup cost by table size
+////
+
+void noteDispatch(const FrameHandle &, PacketProcessor &) { sink++; }
+
+template<size_t... I> constexpr auto syntheticTable(std::index_sequence<I...>) {
+  return makeDispatchTable(PacketHandler{0x62, static_cast<uint8_t>(I * 7 + 1), false, false, &noteDispatch}...);
+}
+
+template<size_t N> void benchTableSize(uint64_t lookups) {
+  static constexpr auto TABLE = syntheticTable(std::make_index_sequence<N>());
+  static_assert(!TABLE.hasDuplicates(), "Synthetic keys must be unique");
+
+  char name[64];
+  snprintf(name, sizeof(name), "table lookup, %2u handlers", static_cast<unsigned>(N));
+  BenchCase bench(name);
+  bench.start();
+  for (uint64_t i = 0; i < lookups; i++) {
+    // Every registered command, then one that isn't
+    const size_t key = i % (N + 1);
+    const PacketHandler *handler = TABLE.find(0x62, key < N ? key * 7 + 1 : 0);
+    sink += reinterpret_cast<uintptr_t>(handler) & 0xff;
+  }
+  bench.stop(lookups);
+  bench.print("lookup");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t frames = benchCount(argc, argv, 10000000);
+  quietLogs();
+
+  const std::vector<RawPacket> mix = frameMix();
+  benchLegacy(mix, frames);
+  benchTable(mix, frames);
+
+  benchTableSize<4>(frames);
+  benchTableSize<8>(frames);
+  benchTableSize<16>(frames);
+  benchTableSize<32>(frames);
+  return sink == 0;
+}
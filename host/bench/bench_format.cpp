@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "muart_packet.h"
+#include "muart_utils.h"
+#include <sstream>
+
+/* Cost of formatting a packet for the log.
+
+The "stringstream" cases are reference copies of the original Packet::to_string() (hex dump through a
+std::stringstream) and SettingsGetResponsePacket::to_string() (std::string concatenation of the decoded fields).  The
+"FormatBuffer" cases are the current formatPacket() into a stack buffer, as the MUART_LOG*_PACKET macros do it.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+uint64_t sink = 0;
+
+////
+// Original: std::stringstream and std::string
+////
+
+char legacyHexChar(uint8_t v) { return v >= 10 ? 'A' + (v - 10) : '0' + v; }
+
+std::string legacyHex(uint8_t value) {
+  char text[3];
+  snprintf(text, sizeof(text), "%02x", value);
+  return text;
+}
+
+std::string legacyPacketToString(const RawPacket &pkt) {
+  if (pkt.getLength() < PACKET_HEADER_SIZE) return "";
+  std::stringstream stream;
+
+  stream << CONSOLE_COLOR_CYAN;
+  stream << '[';
+  for (size_t i = 0; i < PACKET_HEADER_SIZE; i++) {
+    if (i == 1) stream << CONSOLE_COLOR_CYAN_BOLD;
+    stream << legacyHexChar((pkt.getBytes()[i] & 0xF0) >> 4);
+    stream << legacyHexChar(pkt.getBytes()[i] & 0x0F);
+    if (i < PACKET_HEADER_SIZE - 1) stream << '.';
+    if (i == 1) stream << CONSOLE_COLOR_CYAN;
+  }
+  stream << ']';
+  stream << CONSOLE_COLOR_WHITE;
+
+  for (size_t i = PACKET_HEADER_SIZE; i < pkt.getLength() - 1U; i++) {
+    stream << legacyHexChar((pkt.getBytes()[i] & 0xF0) >> 4);
+    stream << legacyHexChar(pkt.getBytes()[i] & 0x0F);
+    if (i < pkt.getLength() - 2U) stream << '.';
+  }
+
+  stream << ' ';
+  stream << CONSOLE_COLOR_GREEN;
+  stream << legacyHexChar((pkt.getBytes()[pkt.getLength() - 1] & 0xF0) >> 4);
+  stream << legacyHexChar(pkt.getBytes()[pkt.getLength() - 1] & 0x0F);
+  stream << CONSOLE_COLOR_NONE;
+
+  return stream.str();
+}
+
+std::string legacySettingsToString(const SettingsGetResponsePacket &packet) {
+  return ("Settings Response: " + legacyPacketToString(packet.rawPacket()) + CONSOLE_COLOR_PURPLE +
+          "\n Fan:" + legacyHex(packet.getFan()) + " Mode:" + legacyHex(packet.getMode()) +
+          " Power:" + (packet.getPower() == 3 ? "Test" : packet.getPower() > 0 ? "On" : "Off") +
+          " TargetTemp:" + std::to_string(packet.getTargetTemp()) + " Vane:" + legacyHex(packet.getVane()) +
+          " HVane:" + legacyHex(packet.getHorizontalVane()) + "\n PowerLock:" + (packet.lockedPower() ? "Yes" : "No") +
+          " ModeLock:" + (packet.lockedMode() ? "Yes" : "No") + " TempLock:" + (packet.lockedTemp() ? "Yes" : "No"));
+}
+
+template<typename F> void benchCase(const char *name, uint64_t packets, F format) {
+  for (int i = 0; i < 1000; i++) format();
+  BenchCase bench(name);
+  bench.start();
+  for (uint64_t i = 0; i < packets; i++) format();
+  bench.stop(packets);
+  bench.print("packet");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t packets = benchCount(argc, argv, 1000000);
+
+  RawPacket frame(PacketType::get_response, 16);
+  frame.setPayloadByte(0, static_cast<uint8_t>(GetCommand::settings))
+      .setPayloadByte(3, 0x01)
+      .setPayloadByte(4, SettingsSetRequestPacket::MODE_BYTE_HEAT)
+      .setPayloadByte(7, SettingsSetRequestPacket::VANE_3)
+      .setPayloadByte(10, SettingsSetRequestPacket::HV_CENTER)
+      .setPayloadByte(11, MUARTUtils::DegCToTempScaleA(21.5f))
+      .finalize();
+  const SettingsGetResponsePacket settings(framePool().acquire(frame));
+  const Packet &generic = settings;
+
+  benchCase("hex dump, stringstream (original)", packets,
+            [&]() { sink += legacyPacketToString(settings.rawPacket()).size(); });
+  benchCase("hex dump, FormatBuffer", packets, [&]() {
+    char buffer[PACKET_FORMAT_BUFFER_SIZE];
+    FormatBuffer out(buffer, sizeof(buffer));
+    formatPacket(out, generic);
+    sink += out.length();
+  });
+  benchCase("settings response, std::string (original)", packets,
+            [&]() { sink += legacySettingsToString(settings).size(); });
+  benchCase("settings response, FormatBuffer", packets, [&]() {
+    char buffer[PACKET_FORMAT_BUFFER_SIZE];
+    FormatBuffer out(buffer, sizeof(buffer));
+    formatPacket(out, settings);
+    sink += out.length();
+  });
+  return sink == 0;
+}
@@ -0,0 +1,149 @@
+#include "bench.h"
+#include "legacy.h"
+#include "muart_bridge.h"
+#include "scripted_uart.h"
+#include <queue>
+
+/* Frame copies on the forwarding path: a thermostat hello read from the thermostat, passed through to the heatpump
+and written out.
+
+The "by value" case is the original path: the frame read into a RawPacket, returned in an optional, moved into a
+Packet, and pushed by value onto the heatpump's std::queue.  The "frame pool" case runs the current bridges: the frame
+is received into a pool slot and every later step shares its handle, so the only frame copy is the one made on
+receipt.  Bytes copied are counted by the legacy RawPacket's constructors, and by the pool's write count for the
+current path.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+uint64_t sink = 0;
+
+std::vector<uint8_t> helloFrame() {
+  RawPacket hello(PacketType::set_request, 4, SourceBridge::thermostat, ControllerAssociation::thermostat);
+  hello.setPayloadByte(0, static_cast<uint8_t>(SetCommand::thermostat_hello));
+  return frameBytes(hello);
+}
+
+std::string copiedPerFrame(uint64_t bytesCopied, uint64_t frames) {
+  char extra[64];
+  snprintf(extra, sizeof(extra), "%.1f bytes copied/frame", static_cast<double>(bytesCopied) / frames);
+  return extra;
+}
+
+////
+// Original: packets held and queued by value
+////
+
+// The original receiveRawPacket, reading a whole frame at a time
+optional<legacy::RawPacket> legacyReceive(uart::UARTComponent &uart) {
+  uint8_t bytes[PACKET_MAX_SIZE];
+  if (uart.available() < PACKET_HEADER_SIZE || !uart.read_array(bytes, PACKET_HEADER_SIZE)) return nullopt;
+  const uint8_t payloadSize = bytes[PACKET_HEADER_INDEX_PAYLOAD_LENGTH];
+  if (!uart.read_array(bytes + PACKET_HEADER_SIZE, payloadSize + 1)) return nullopt;
+  return legacy::RawPacket(bytes, PACKET_HEADER_SIZE + payloadSize + 1, SourceBridge::thermostat,
+                           ControllerAssociation::thermostat);
+}
+
+class LegacyHeatpumpBridge {
+ public:
+  explicit LegacyHeatpumpBridge(uart::UARTComponent &uart) : uart{uart} {}
+
+  void sendPacket(const legacy::Packet &packet) { queue.push(packet); }
+  void loop() {
+    if (queue.empty()) return;
+    const legacy::RawPacket &frame = queue.front().rawPacket();
+    uart.write_array(frame.getBytes(), frame.getLength());
+    queue.pop();
+  }
+
+ private:
+  uart::UARTComponent &uart;
+  std::queue<legacy::Packet> queue;
+};
+
+void benchLegacy(const std::vector<uint8_t> &stream, uint64_t frames) {
+  ScriptedUART thermostatUart;
+  ScriptedUART heatpumpUart;
+  heatpumpUart.setCaptureWrites(false);
+  LegacyHeatpumpBridge heatpump(heatpumpUart);
+  auto step = [&]() {
+    if (optional<legacy::RawPacket> pkt = legacyReceive(thermostatUart)) {
+      legacy::Packet packet(std::move(pkt.value()));
+      packet.setResponseExpected(false);
+      heatpump.sendPacket(packet);
+    }
+    heatpump.loop();
+  };
+
+  const uint64_t warmup = 1000;
+  thermostatUart.repeat(stream.data(), stream.size(), (warmup + frames) * stream.size());
+  while (thermostatUart.pending() > frames * stream.size()) step();
+
+  const uint64_t copiedAtStart = legacy::RawPacket::bytesCopied;
+  BenchCase bench("by value: optional -> Packet -> std::queue");
+  bench.start();
+  while (thermostatUart.pending() > 0) step();
+  heatpump.loop();
+  bench.stop(frames);
+  bench.print("frame", copiedPerFrame(legacy::RawPacket::bytesCopied - copiedAtStart, frames));
+  sink += heatpumpUart.writtenCount();
+}
+
+////
+// Current: frame handles into the pool
+////
+
+// Forwards everything the thermostat sends to the heatpump, as MitsubishiUART::cutThrough does
+class ForwardingProcessor : public PacketProcessor {
+ public:
+  void cutThrough(const FrameHandle &frame) override {
+    frame->setForwarded();
+    if (!heatpump->forwardFrame(frame)) frame->setForwarded(false);
+  }
+
+  MUARTBridge *heatpump = nullptr;
+};
+
+void benchFramePool(const std::vector<uint8_t> &stream, uint64_t frames) {
+  ScriptedUART thermostatUart;
+  ScriptedUART heatpumpUart;
+  heatpumpUart.setCaptureWrites(false);
+  ForwardingProcessor processor;
+  ThermostatBridge thermostat(&thermostatUart, &processor);
+  HeatpumpBridge heatpump(&heatpumpUart, &processor);
+  processor.heatpump = &heatpump;
+  auto step = [&]() {
+    thermostat.loop();
+    heatpump.loop();
+  };
+
+  const uint64_t warmup = 1000;
+  thermostatUart.repeat(stream.data(), stream.size(), (warmup + frames) * stream.size());
+  while (thermostatUart.pending() > frames * stream.size()) step();
+
+  const uint32_t writtenAtStart = framePool().writtenCount();
+  BenchCase bench("frame pool: shared FrameHandle");
+  bench.start();
+  while (thermostatUart.pending() > 0) step();
+  heatpump.loop();
+  bench.stop(frames);
+  const uint64_t bytesCopied = static_cast<uint64_t>(framePool().writtenCount() - writtenAtStart) * sizeof(RawPacket);
+  bench.print("frame", copiedPerFrame(bytesCopied, frames));
+  sink += heatpumpUart.writtenCount();
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t frames = benchCount(argc, argv, 1000000);
+  quietLogs();
+
+  const std::vector<uint8_t> hello = helloFrame();
+  benchLegacy(hello, frames);
+  benchFramePool(hello, frames);
+  return sink == 0;
+}
@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "heatpump_sim.h"
+#include "muart_harness.h"
+
+/* End to end against the simulated heatpump: MitsubishiUART connects, polls and controls a HeatpumpSim over 2400-baud
+wire timing, in virtual time.
+
+Each case starts the component, waits for it to connect and report the unit's state, then raises the setpoint and
+runs for `--count` simulated seconds.  It reports how long the settings change took to reach the unit, how long until
+the compressor starting was reported back, the component's own round trip percentiles, and how often each command was
+polled.  Cases differ in the unit's processing delay.  The run fails if the component and the unit disagree at the end,
+or if preferences were written during the run (the temperature source, the only preference, never changes).
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+const uint64_t SECOND_MICROS = 1000000;
+
+const std::pair<GetCommand, const char *> POLLED[] = {{GetCommand::settings, "settings"},
+                                                      {GetCommand::current_temp, "temp"},
+                                                      {GetCommand::status, "status"},
+                                                      {GetCommand::standby, "standby"},
+                                                      {GetCommand::error_info, "error"}};
+
+bool near(float a, float b) { return std::fabs(a - b) < 0.01f; }
+
+bool runCase(const char *name, uint32_t processingMicros, uint64_t seconds) {
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(false);
+  HeatpumpSim sim(harness.heatpumpUart);
+  sim.processingMicros = processingMicros;
+  sim.mutableState().power = true;
+  harness.setup();
+
+  // Connect, and let every command be polled at least once
+  harness.runFor(30 * SECOND_MICROS);
+  if (!near(harness.muart.target_temperature, sim.state().targetTemperature)) {
+    printf("%s: never picked up the unit's settings (target %.1f)\n", name, harness.muart.target_temperature);
+    return false;
+  }
+
+  uint32_t pollsBefore[sizeof(POLLED) / sizeof(POLLED[0])];
+  for (size_t i = 0; i < sizeof(POLLED) / sizeof(POLLED[0]); i++) {
+    pollsBefore[i] = sim.received(PacketType::get_request, static_cast<uint8_t>(POLLED[i].first));
+  }
+
+  const uint32_t savesBefore = ESPPreferenceObject::host_save_count();
+  const uint64_t changedMicros = nowMicros();
+  harness.muart.make_call().set_target_temperature(25.0f).perform();
+
+  uint64_t compressorSeenMicros = 0;
+  harness.compressorFrequency.add_on_state_callback([&compressorSeenMicros](float frequency) {
+    if (frequency > 0 && compressorSeenMicros == 0) compressorSeenMicros = nowMicros();
+  });
+
+  uint64_t loops = 0;
+  BenchCase bench(name);
+  bench.start();
+  const uint64_t until = nowMicros() + seconds * SECOND_MICROS;
+  while (nowMicros() < until) {
+    harness.loopOnce();
+    setMicros(nowMicros() + harness.loopMicros);
+    loops++;
+  }
+  bench.stop(loops);
+
+  const HeatpumpSim::State &unit = sim.state();
+  char extra[256];
+  int used = snprintf(extra, sizeof(extra), "set->unit %.0f ms, compressor seen %.1f s, rtt p50/p95/max %.0f/%.0f/%.0f ms, polls/min",
+                      (sim.lastSettingsSetMicros() - changedMicros) / 1000.0,
+                      compressorSeenMicros ? (compressorSeenMicros - changedMicros) / 1e6 : -1.0,
+                      harness.roundTripP50.state, harness.roundTripP95.state, harness.roundTripMax.state);
+  for (size_t i = 0; i < sizeof(POLLED) / sizeof(POLLED[0]) && used < static_cast<int>(sizeof(extra)); i++) {
+    const uint32_t polls = sim.received(PacketType::get_request, static_cast<uint8_t>(POLLED[i].first)) - pollsBefore[i];
+    used += snprintf(extra + used, sizeof(extra) - used, " %s %.1f", POLLED[i].second, polls * 60.0 / seconds);
+  }
+  const uint32_t saves = ESPPreferenceObject::host_save_count() - savesBefore;
+  if (used < static_cast<int>(sizeof(extra))) snprintf(extra + used, sizeof(extra) - used, ", preference saves %u", saves);
+  bench.print("loop", extra);
+
+  bool agree = true;
+  if (!near(unit.targetTemperature, 25.0f) || !near(harness.muart.target_temperature, 25.0f)) {
+    printf("%s: setpoint not applied (unit %.1f, component %.1f)\n", name, unit.targetTemperature,
+           harness.muart.target_temperature);
+    agree = false;
+  }
+  // The component reports what the unit said at its last poll, so allow for the drift since then
+  if (std::fabs(harness.muart.current_temperature - unit.roomTemperature) > 0.5f) {
+    printf("%s: room temperature %.1f, unit says %.1f\n", name, harness.muart.current_temperature,
+           unit.roomTemperature);
+    agree = false;
+  }
+  if (saves > 0) {
+    printf("%s: preferences saved %u times, though the temperature source never changed\n", name, saves);
+    agree = false;
+  }
+  if (compressorSeenMicros == 0 || sim.rejected() > 0) {
+    printf("%s: compressor never reported running (%u frames rejected by the unit)\n", name, sim.rejected());
+    agree = false;
+  }
+  return agree;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t seconds = benchCount(argc, argv, 3600);
+  quietLogs();
+
+  bool ok = true;
+  ok &= runCase("processing delay 10 ms", 10000, seconds);
+  ok &= runCase("processing delay 30 ms", 30000, seconds);
+  ok &= runCase("processing delay 100 ms", 100000, seconds);
+  return ok ? 0 : 1;
+}
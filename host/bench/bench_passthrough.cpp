@@ -0,0 +1,140 @@
+#include "bench.h"
+#include "heatpump_sim.h"
+#include "mhk2_sim.h"
+#include "muart_harness.h"
+#include <algorithm>
+
+/* Thermostat passthrough: a simulated MHK2 on the thermostat bridge, the simulated heatpump on the other, and
+MitsubishiUART in the middle, in virtual time with 2400-baud wire timing on both sides.
+
+For each of the thermostat's exchanges, the added latency is the time from its request arriving at MUART to the
+response arriving back, less what the same exchange takes with the thermostat wired straight to the unit (the unit's
+processing delay plus the response's wire time).  Cases run MUART passive (forwarding only), then active with its own
+polls competing for the heatpump bus, with cut-through forwarding, and with thermostat gets answered from the response
+cache, each with the thermostat polling back to back and polling slowly (which leaves MUART polling for itself rather
+than reading the thermostat's responses).  A request reaching the unit is the thermostat's if it's the first copy of
+the thermostat's latest request, and MUART's own otherwise.  "Queued behind MUART" is the share of exchanges that took
+longer than the passive case's worst, i.e. that waited for one of MUART's own requests.
+
+The run fails if the thermostat doesn't complete its handshake, or any of its requests go unanswered.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+const uint64_t SECOND_MICROS = 1000000;
+
+struct PassthroughCase {
+  const char *name;
+  bool active;
+  bool cutThrough;
+  uint32_t cacheMaxAgeMillis;
+  uint32_t thermostatGapMillis;
+};
+
+double percentile(const std::vector<double> &sorted, double fraction) {
+  if (sorted.empty()) return 0;
+  return sorted[std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+// Runs a case, setting the worst added latency (ms).  Returns false if the thermostat didn't get its answers.
+bool runCase(const PassthroughCase &config, uint64_t seconds, double passiveWorstMillis, double &worstMillis) {
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(true);
+  harness.muart.set_active_mode(config.active);
+  harness.muart.set_thermostat_cut_through(config.cutThrough);
+  harness.muart.set_thermostat_cache_max_age(config.cacheMaxAgeMillis);
+  HeatpumpSim heatpump(harness.heatpumpUart);
+  heatpump.mutableState().power = true;
+  Mhk2Sim thermostat(harness.thermostatUart);
+  thermostat.requestGapMicros = config.thermostatGapMillis * 1000;
+  harness.addTicker([&thermostat]() { thermostat.tick(); });
+
+  uint32_t ownRequests = 0;
+  uint32_t claimedRequest = 0;
+  heatpump.onRequest([&](const RawPacket &request, uint64_t) {
+    const RawPacket &latest = thermostat.lastRequest();
+    if (claimedRequest != thermostat.requestsSent() && request.getLength() == latest.getLength() &&
+        memcmp(request.getBytes(), latest.getBytes(), latest.getLength()) == 0) {
+      claimedRequest = thermostat.requestsSent();
+    } else {
+      ownRequests++;
+    }
+  });
+
+  std::vector<double> addedMillis;
+  thermostat.onExchange([&](const Mhk2Sim::Exchange &exchange) {
+    const uint64_t direct = heatpump.processingMicros +
+                            static_cast<uint64_t>(harness.heatpumpUart.byteMicros()) * exchange.responseLength;
+    addedMillis.push_back((static_cast<double>(exchange.responseMicros - exchange.requestArrivedMicros) - direct) / 1000.0);
+  });
+
+  harness.setup();
+  uint64_t loops = 0;
+  BenchCase bench(config.name);
+  bench.start();
+  const uint64_t until = seconds * SECOND_MICROS;
+  while (nowMicros() < until) {
+    harness.loopOnce();
+    setMicros(nowMicros() + harness.loopMicros);
+    loops++;
+  }
+  bench.stop(loops);
+
+  if (!thermostat.connected() || thermostat.timeouts() > 0 || thermostat.unexpected() > 0 || heatpump.rejected() > 0) {
+    printf("%s: handshake %s, %u timeouts, %u unexpected frames at the thermostat, %u rejected by the unit\n",
+           config.name, thermostat.connected() ? "done" : "not done", thermostat.timeouts(), thermostat.unexpected(),
+           heatpump.rejected());
+    return false;
+  }
+
+  std::vector<double> sorted = addedMillis;
+  std::sort(sorted.begin(), sorted.end());
+  double total = 0;
+  size_t queued = 0;
+  for (double added : sorted) {
+    total += added;
+    if (passiveWorstMillis >= 0 && added > passiveWorstMillis) queued++;
+  }
+
+  char extra[256];
+  snprintf(extra, sizeof(extra),
+           "%zu exchanges, added ms mean/p50/p95/max %.1f/%.1f/%.1f/%.1f, own requests %.1f/min, queued behind MUART %.1f%%",
+           sorted.size(), sorted.empty() ? 0 : total / sorted.size(), percentile(sorted, 0.5),
+           percentile(sorted, 0.95), sorted.empty() ? 0 : sorted.back(), ownRequests * 60.0 / seconds,
+           sorted.empty() ? 0 : queued * 100.0 / sorted.size());
+  bench.print("loop", extra);
+  worstMillis = sorted.empty() ? 0 : sorted.back();
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t seconds = benchCount(argc, argv, 1800);
+  quietLogs();
+
+  const PassthroughCase cases[] = {
+      {"busy thermostat: passive, store and forward", false, false, 0, 250},
+      {"busy thermostat: active, store and forward", true, false, 0, 250},
+      {"busy thermostat: active, cut-through", true, true, 0, 250},
+      {"busy thermostat: active, cut-through, cache", true, true, 5000, 250},
+      {"slow thermostat: passive, store and forward", false, false, 0, 5000},
+      {"slow thermostat: active, store and forward", true, false, 0, 5000},
+      {"slow thermostat: active, cut-through", true, true, 0, 5000},
+      {"slow thermostat: active, cut-through, cache", true, true, 5000, 5000},
+  };
+
+  bool ok = true;
+  double passiveWorst = -1;
+  for (const PassthroughCase &config : cases) {
+    double worst = 0;
+    ok &= runCase(config, seconds, config.active ? passiveWorst : -1, worst);
+    if (!config.active) passiveWorst = worst;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "bench.h"
+#include "muart_harness.h"
+#include "muart_utils.h"
+
+/* Frames per second through the receive pipeline: receiveRawPacket -> classifyAndProcessRawPacket -> processPacket.
+
+The heatpump UART replays a stream of get responses.  "bridge" cases run HeatpumpBridge::loop() with a processor that
+does nothing, so they measure parsing, the frame pool and dispatch alone; "component" cases run MitsubishiUART::loop()
+and the scheduler, so they include decoding, state updates and (when the state changes) publishing.  The component is
+passive (active mode off) so that its own polls don't compete with the replayed stream for the bus.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+// Responses to a full poll, with the given room temperature and compressor frequency
+std::vector<uint8_t> pollResponses(float roomTemp, uint8_t compressorFrequency) {
+  std::vector<uint8_t> stream;
+  auto add = [&stream](const RawPacket &frame) {
+    const std::vector<uint8_t> bytes = frameBytes(frame);
+    stream.insert(stream.end(), bytes.begin(), bytes.end());
+  };
+
+  RawPacket settings(PacketType::get_response, 16);
+  settings.setPayloadByte(0, static_cast<uint8_t>(GetCommand::settings))
+      .setPayloadByte(3, 0x01)
+      .setPayloadByte(4, SettingsSetRequestPacket::MODE_BYTE_HEAT)
+      .setPayloadByte(10, SettingsSetRequestPacket::HV_CENTER)
+      .setPayloadByte(11, MUARTUtils::DegCToTempScaleA(21.0f));
+  add(settings);
+
+  RawPacket currentTemp(PacketType::get_response, 16);
+  currentTemp.setPayloadByte(0, static_cast<uint8_t>(GetCommand::current_temp))
+      .setPayloadByte(6, MUARTUtils::DegCToTempScaleA(roomTemp));
+  add(currentTemp);
+
+  RawPacket status(PacketType::get_response, 16);
+  status.setPayloadByte(0, static_cast<uint8_t>(GetCommand::status))
+      .setPayloadByte(3, compressorFrequency)
+      .setPayloadByte(4, compressorFrequency > 0);
+  add(status);
+
+  RawPacket standby(PacketType::get_response, 16);
+  standby.setPayloadByte(0, static_cast<uint8_t>(GetCommand::standby)).setPayloadByte(4, 0x02);
+  add(standby);
+
+  RawPacket error(PacketType::get_response, 16);
+  error.setPayloadByte(0, static_cast<uint8_t>(GetCommand::error_info)).setPayloadByte(4, 0x80);
+  add(error);
+
+  return stream;
+}
+
+class NullProcessor : public PacketProcessor {};
+
+class BenchBridge : public HeatpumpBridge {
+ public:
+  using HeatpumpBridge::HeatpumpBridge;
+  uint32_t framesReceived() const { return getStat(BridgeStat::frames_received); }
+};
+
+void benchBridge(const char *name, const std::vector<uint8_t> &stream, uint64_t frames) {
+  ScriptedUART uart;
+  NullProcessor processor;
+  BenchBridge bridge(&uart, &processor);
+  const uint64_t framesPerStream = stream.size() / PACKET_MAX_SIZE;
+  const uint64_t warmup = framesPerStream * 20;
+
+  uart.repeat(stream.data(), stream.size(), (warmup + frames) * PACKET_MAX_SIZE);
+  while (bridge.framesReceived() < warmup) bridge.loop();
+
+  BenchCase bench(name);
+  bench.start();
+  while (uart.pending() > 0) bridge.loop();
+  bench.stop(bridge.framesReceived() - warmup);
+  bench.print("frame");
+}
+
+void benchComponent(const char *name, const std::vector<uint8_t> &stream, uint64_t frames) {
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(false);
+  harness.muart.set_active_mode(false);
+  harness.setup();
+  const uint64_t frameMicros = harness.heatpumpUart.byteMicros() * PACKET_MAX_SIZE;
+  const uint64_t warmup = (stream.size() / PACKET_MAX_SIZE) * 20;
+
+  auto step = [&harness, frameMicros]() {
+    harness.muart.loop();
+    runScheduler();
+    advanceMicros(frameMicros);
+  };
+
+  harness.heatpumpUart.repeat(stream.data(), stream.size(), (warmup + frames) * PACKET_MAX_SIZE);
+  while (harness.heatpumpUart.pending() > frames * PACKET_MAX_SIZE) step();
+
+  BenchCase bench(name);
+  bench.start();
+  uint64_t loops = 0;
+  while (harness.heatpumpUart.pending() > 0) {
+    step();
+    loops++;
+  }
+  bench.stop(frames);
+  char extra[64];
+  snprintf(extra, sizeof(extra), "%.2f loops/frame", static_cast<double>(loops) / frames);
+  bench.print("frame", extra);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t frames = benchCount(argc, argv, 200000);
+  quietLogs();
+
+  const std::vector<uint8_t> steady = pollResponses(20.5f, 40);
+  std::vector<uint8_t> changing = steady;
+  const std::vector<uint8_t> changed = pollResponses(21.0f, 44);
+  changing.insert(changing.end(), changed.begin(), changed.end());
+
+  benchBridge("bridge: poll responses", steady, frames);
+  benchComponent("component: poll responses, steady state", steady, frames);
+  benchComponent("component: poll responses, state changing", changing, frames);
+  return 0;
+}
@@ -0,0 +1,87 @@
+#include "bench.h"
+#include "legacy.h"
+#include "muart_bridge.h"
+#include <queue>
+
+/* Send queue cost per packet: queueing a poll cycle's requests, then sending each one (taking the head, keeping it as
+the request awaiting a response, and popping it).
+
+The "std::queue" case is the original send queue, a std::queue<Packet> (backed by std::deque) of packets held by
+value.  The "PacketQueue" case is the current one: fixed rings of frame handles in priority lanes.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+const GetCommand POLL_COMMANDS[] = {GetCommand::settings, GetCommand::standby, GetCommand::status,
+                                    GetCommand::current_temp, GetCommand::error_info};
+const size_t POLL_SIZE = sizeof(POLL_COMMANDS) / sizeof(POLL_COMMANDS[0]);
+
+uint64_t sink = 0;
+
+void benchLegacy(uint64_t packets) {
+  legacy::Packet requests[POLL_SIZE];
+  for (size_t i = 0; i < POLL_SIZE; i++) {
+    const std::vector<uint8_t> bytes = frameBytes(RawPacket(PacketType::get_request, 1).setPayloadByte(
+        0, static_cast<uint8_t>(POLL_COMMANDS[i])));
+    requests[i] = legacy::Packet(legacy::RawPacket(bytes.data(), bytes.size()));
+  }
+
+  std::queue<legacy::Packet> queue;
+  optional<legacy::Packet> awaitingResponse;
+  auto cycle = [&]() {
+    for (const legacy::Packet &request : requests) {
+      if (queue.size() <= MAX_QUEUE_SIZE) queue.push(request);
+    }
+    while (!queue.empty()) {
+      if (queue.front().isResponseExpected()) awaitingResponse = queue.front();
+      sink += queue.front().rawPacket().getLength();
+      queue.pop();
+    }
+  };
+
+  for (int i = 0; i < 100; i++) cycle();
+  BenchCase bench("std::queue<Packet>");
+  bench.start();
+  for (uint64_t sent = 0; sent < packets; sent += POLL_SIZE) cycle();
+  bench.stop(packets);
+  bench.print("packet");
+}
+
+void benchPacketQueue(uint64_t packets) {
+  PacketQueue<static_cast<size_t>(PacketPriority::count), MAX_QUEUE_SIZE> queue{QUEUE_STARVATION_TIMEOUT_MS};
+  FrameHandle awaitingResponse;
+  const size_t pollLane = static_cast<size_t>(PacketPriority::poll);
+  auto cycle = [&]() {
+    for (GetCommand command : POLL_COMMANDS) {
+      const Packet &request = GetRequestPacket::getInstance(command);
+      queue.push(pollLane, QueuedPacket{request.frame(), request.isResponseExpected(), millis()});
+    }
+    while (!queue.empty()) {
+      const int lane = queue.nextLane(millis());
+      const QueuedPacket &queued = queue.lane(lane).front();
+      if (queued.responseExpected) awaitingResponse = queued.packet;
+      sink += queued.packet->getLength();
+      queue.pop(lane, millis());
+    }
+  };
+
+  for (int i = 0; i < 100; i++) cycle();
+  BenchCase bench("PacketQueue (rings of frame handles)");
+  bench.start();
+  for (uint64_t sent = 0; sent < packets; sent += POLL_SIZE) cycle();
+  bench.stop(packets);
+  bench.print("packet");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  const uint64_t packets = benchCount(argc, argv, 5000000);
+  benchLegacy(packets);
+  benchPacketQueue(packets);
+  return sink == 0;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "muart_rawpacket.h"
+#include <string>
+
+/* Reference versions of data structures the component has since replaced, reduced to what the benchmarks exercise, so
+that each benchmark can report the old approach next to the current one.  They follow the shape of the originals
+(virtual methods, copies by value, heap-backed containers), not their every detail.
+*/
+
+namespace esphome {
+namespace host {
+namespace legacy {
+
+using mitsubishi_uart::ControllerAssociation;
+using mitsubishi_uart::PACKET_HEADER_INDEX_PAYLOAD_LENGTH;
+using mitsubishi_uart::PACKET_HEADER_INDEX_PACKET_TYPE;
+using mitsubishi_uart::PACKET_HEADER_SIZE;
+using mitsubishi_uart::PACKET_MAX_SIZE;
+using mitsubishi_uart::SourceBridge;
+
+// The original RawPacket: the frame, plus a vtable for to_string().  Counts the bytes it copies.
+class RawPacket {
+ public:
+  RawPacket() = default;
+  RawPacket(const RawPacket &other) { copyFrom(other); }
+  RawPacket &operator=(const RawPacket &other) {
+    copyFrom(other);
+    return *this;
+  }
+  RawPacket(const uint8_t *bytes, uint8_t length, SourceBridge source_bridge = SourceBridge::none,
+            ControllerAssociation controller_association = ControllerAssociation::muart)
+      : length{length}, checksumIndex{static_cast<uint8_t>(length - 1)}, sourceBridge{source_bridge},
+        controllerAssociation{controller_association} {
+    memcpy(packetBytes, bytes, length);
+    bytesCopied += sizeof(RawPacket);
+  }
+  virtual ~RawPacket() {}
+
+  // Bytes copied by constructing or copying RawPackets (the frame, its bookkeeping and vtable pointer)
+  static inline uint64_t bytesCopied = 0;
+
+  virtual std::string to_string() const { return format_hex_pretty(packetBytes, length); }
+
+  uint8_t getLength() const { return length; }
+  const uint8_t *getBytes() const { return packetBytes; }
+  uint8_t getPacketType() const { return packetBytes[PACKET_HEADER_INDEX_PACKET_TYPE]; }
+  uint8_t getCommand() const { return packetBytes[PACKET_HEADER_SIZE]; }
+  uint8_t getPayloadByte(uint8_t index) const { return packetBytes[PACKET_HEADER_SIZE + index]; }
+  SourceBridge getSourceBridge() const { return sourceBridge; }
+  ControllerAssociation getControllerAssociation() const { return controllerAssociation; }
+
+ private:
+  void copyFrom(const RawPacket &other) {
+    memcpy(packetBytes, other.packetBytes, sizeof(packetBytes));
+    length = other.length;
+    checksumIndex = other.checksumIndex;
+    sourceBridge = other.sourceBridge;
+    controllerAssociation = other.controllerAssociation;
+    bytesCopied += sizeof(RawPacket);
+  }
+
+  uint8_t packetBytes[PACKET_MAX_SIZE]{};
+  uint8_t length = 0;
+  uint8_t checksumIndex = 0;
+  SourceBridge sourceBridge = SourceBridge::none;
+  ControllerAssociation controllerAssociation = ControllerAssociation::muart;
+};
+
+// The original Packet: a RawPacket held by value, copied whenever the packet is
+class Packet {
+ public:
+  Packet() = default;
+  explicit Packet(RawPacket &&pkt) : pkt_(std::move(pkt)) {}
+  virtual ~Packet() {}
+
+  virtual std::string to_string() const { return pkt_.to_string(); }
+
+  bool isResponseExpected() const { return responseExpected; }
+  void setResponseExpected(bool expectResponse) { responseExpected = expectResponse; }
+  RawPacket &rawPacket() { return pkt_; }
+  const RawPacket &rawPacket() const { return pkt_; }
+  uint8_t getPacketType() const { return pkt_.getPacketType(); }
+
+ protected:
+  RawPacket pkt_;
+
+ private:
+  bool responseExpected = true;
+};
+
+}  // namespace legacy
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "muart_rawpacket.h"
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+/* Splits a byte stream into CN105 frames, for the simulated equipment on the far end of a ScriptedUART.  Bytes that
+can't start a frame, and frames with a bad checksum, are counted and dropped.
+*/
+class FrameReader {
+ public:
+  // Adds bytes to the stream, calling `onFrame` with each complete, valid frame
+  template<typename Callback> void push(const uint8_t *data, size_t length, Callback &&onFrame) {
+    buffer.insert(buffer.end(), data, data + length);
+
+    while (!buffer.empty()) {
+      if (buffer[0] != mitsubishi_uart::BYTE_CONTROL) {
+        drop(1);
+        continue;
+      }
+      if (buffer.size() < mitsubishi_uart::PACKET_HEADER_SIZE) return;
+      const size_t frameLength =
+          mitsubishi_uart::PACKET_HEADER_SIZE + buffer[mitsubishi_uart::PACKET_HEADER_INDEX_PAYLOAD_LENGTH] + 1;
+      if (frameLength > mitsubishi_uart::PACKET_MAX_SIZE) {
+        drop(1);
+        continue;
+      }
+      if (buffer.size() < frameLength) return;
+
+      uint8_t sum = 0;
+      for (size_t i = 0; i + 1 < frameLength; i++) sum += buffer[i];
+      if (static_cast<uint8_t>(0xfc - sum) == buffer[frameLength - 1]) {
+        onFrame(mitsubishi_uart::RawPacket(buffer.data(), frameLength));
+        buffer.erase(buffer.begin(), buffer.begin() + frameLength);
+      } else {
+        drop(frameLength);
+      }
+    }
+  }
+
+  // Bytes or frames thrown away
+  uint32_t rejected() const { return rejectedCount; }
+
+ private:
+  void drop(size_t count) {
+    buffer.erase(buffer.begin(), buffer.begin() + count);
+    rejectedCount++;
+  }
+
+  std::vector<uint8_t> buffer;
+  uint32_t rejectedCount = 0;
+};
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,110 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Runs a fuzz target without libFuzzer (e.g. under gcc, or in ctest): every regression input given, then --count
+random inputs from a fixed --seed.
+
+  fuzz_receive [--count N] [--seed S] <input file or directory>...
+
+Random inputs are mostly BYTE_CONTROL and small values, so that they make it past the header into the parser's later
+states, and half of them are mutations of a regression input.  A failing random input is written to
+fuzz-failure.bin before the target aborts, so it can be added to the regression inputs.
+*/
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+const size_t MAX_INPUT_SIZE = 256;
+
+std::vector<uint8_t> readInput(const std::filesystem::path &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+uint8_t randomByte(std::mt19937 &random) {
+  switch (random() % 4) {
+    case 0:
+      return 0xfc;
+    case 1:
+      return random() % 0x20;
+    default:
+      return random() & 0xff;
+  }
+}
+
+std::vector<uint8_t> randomInput(std::mt19937 &random, const std::vector<std::vector<uint8_t>> &regressions) {
+  std::vector<uint8_t> input;
+  if (!regressions.empty() && random() % 2 == 0) {
+    input = regressions[random() % regressions.size()];
+    const size_t mutations = 1 + random() % 4;
+    for (size_t i = 0; i < mutations; i++) {
+      const size_t at = input.empty() ? 0 : random() % input.size();
+      switch (random() % 3) {
+        case 0:
+          if (!input.empty()) input[at] = randomByte(random);
+          break;
+        case 1:
+          if (input.size() < MAX_INPUT_SIZE) input.insert(input.begin() + at, randomByte(random));
+          break;
+        default:
+          if (!input.empty()) input.erase(input.begin() + at);
+          break;
+      }
+    }
+  } else {
+    input.resize(random() % MAX_INPUT_SIZE);
+    for (uint8_t &byte : input) byte = randomByte(random);
+  }
+  return input;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned long count = 10000;
+  unsigned long seed = 1;
+  std::vector<std::filesystem::path> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      count = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      paths.emplace_back(argv[i]);
+    }
+  }
+
+  std::vector<std::vector<uint8_t>> regressions;
+  for (const std::filesystem::path &path : paths) {
+    if (std::filesystem::is_directory(path)) {
+      for (const auto &entry : std::filesystem::directory_iterator(path)) {
+        if (entry.is_regular_file()) regressions.push_back(readInput(entry.path()));
+      }
+    } else {
+      regressions.push_back(readInput(path));
+    }
+  }
+  for (const std::vector<uint8_t> &input : regressions) LLVMFuzzerTestOneInput(input.data(), input.size());
+
+  std::mt19937 random(seed);
+  for (unsigned long i = 0; i < count; i++) {
+    const std::vector<uint8_t> input = randomInput(random, regressions);
+    // Kept until the next input passes, so a crash leaves it behind
+    std::ofstream("fuzz-failure.bin", std::ios::binary).write(reinterpret_cast<const char *>(input.data()), input.size());
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+  }
+  std::remove("fuzz-failure.bin");
+
+  printf("fuzz_receive: %zu regression inputs and %lu random inputs (seed %lu) passed\n", regressions.size(), count,
+         seed);
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include "muart_harness.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+/* Fuzz target for the receive parser: arbitrary bytes arrive on each bridge's UART, and every frame the parser
+assembles goes on through dispatch and decoding into MitsubishiUART, as it does on the device.
+
+Besides the sanitizers catching any out of bounds access, each call to receiveRawPacket must:
+  - consume at least one byte while any are available, and no more than MAX_BYTES_PER_LOOP
+  - take no longer than MAX_RECEIVE_MICROS_PER_LOOP of wall time
+  - only return frames starting with BYTE_CONTROL whose length matches their header
+
+The host's micros() is virtual, so the bridge's own time limit never cuts a call short here; the wall time is measured
+instead.  A run with a slow call is repeated before it counts as a failure, since the host can be preempted mid-call.
+
+Built for libFuzzer with clang (MUART_HOST_LIBFUZZER), otherwise with fuzz_driver.cpp.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+void check(bool condition, const char *failure) {
+  if (condition) return;
+  fprintf(stderr, "fuzz_receive: %s\n", failure);
+  abort();
+}
+
+// A bridge whose receive side is called directly, one call at a time
+template <typename Bridge> class FuzzBridge : public Bridge {
+ public:
+  using Bridge::Bridge;
+
+  // Returns false if any call took too long
+  bool receiveAll(ScriptedUART &uart, SourceBridge source) {
+    bool inTime = true;
+    while (uart.available() > 0) {
+      const int availableBefore = uart.available();
+      const auto started = std::chrono::steady_clock::now();
+      FrameHandle frame = this->receiveRawPacket(source, ControllerAssociation::muart);
+      const auto elapsed = std::chrono::steady_clock::now() - started;
+      const int consumed = availableBefore - uart.available();
+
+      check(consumed > 0, "receiveRawPacket made no progress");
+      check(consumed <= static_cast<int>(MAX_BYTES_PER_LOOP), "receiveRawPacket consumed more than MAX_BYTES_PER_LOOP");
+      if (std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() > MAX_RECEIVE_MICROS_PER_LOOP) {
+        inTime = false;
+      }
+      if (!frame) continue;
+
+      const RawPacket &pkt = *frame;
+      check(pkt.getLength() <= PACKET_MAX_SIZE && pkt.getLength() > PACKET_HEADER_SIZE, "frame length out of range");
+      check(pkt.getBytes()[0] == BYTE_CONTROL, "frame doesn't start with BYTE_CONTROL");
+      check(pkt.getLength() == PACKET_HEADER_SIZE + pkt.getBytes()[PACKET_HEADER_INDEX_PAYLOAD_LENGTH] + 1,
+            "frame length doesn't match its header");
+      if (pkt.isChecksumValid()) this->classifyAndProcessRawPacket(frame);
+    }
+    return inTime;
+  }
+};
+
+const int MAX_SLOW_RUNS = 5;
+
+// Runs the input through a fresh component, so a failing input reproduces on its own.  Returns false if any call
+// took too long.
+bool runInput(const uint8_t *data, size_t size) {
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(true);
+  harness.setup();
+
+  FuzzBridge<HeatpumpBridge> heatpump(&harness.heatpumpUart, &harness.muart);
+  harness.heatpumpUart.inject(data, size);
+  bool inTime = heatpump.receiveAll(harness.heatpumpUart, SourceBridge::heatpump);
+
+  FuzzBridge<ThermostatBridge> thermostat(&harness.thermostatUart, &harness.muart);
+  harness.thermostatUart.inject(data, size);
+  inTime &= thermostat.receiveAll(harness.thermostatUart, SourceBridge::thermostat);
+  return inTime;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static bool quiet = [] {
+    if (!getenv("MUART_HOST_LOG_LEVEL")) setLogLevel(ESPHOME_LOG_LEVEL_NONE);
+    return true;
+  }();
+  (void) quiet;
+
+  int slowRuns = 0;
+  while (!runInput(data, size)) {
+    check(++slowRuns < MAX_SLOW_RUNS, "receiveRawPacket took longer than MAX_RECEIVE_MICROS_PER_LOOP");
+  }
+  return 0;
+}
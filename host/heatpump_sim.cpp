@@ -0,0 +1,235 @@
+#include "heatpump_sim.h"
+#include "host.h"
+#include "muart_utils.h"
+#include <algorithm>
+
+namespace esphome {
+namespace host {
+
+using namespace mitsubishi_uart;
+
+namespace {
+
+// Payload offsets, as documented for the CN105 protocol
+const uint8_t SET_FLAGS = 1;
+const uint8_t SET_FLAGS2 = 2;
+const uint8_t SETTINGS_SET_POWER = 3;
+const uint8_t SETTINGS_SET_MODE = 4;
+const uint8_t SETTINGS_SET_FAN = 6;
+const uint8_t SETTINGS_SET_VANE = 7;
+const uint8_t SETTINGS_SET_HORIZONTAL_VANE = 13;
+const uint8_t SETTINGS_SET_TARGET = 14;
+const uint8_t SETTINGS_SET_TARGET_LEGACY = 5;
+const uint8_t REMOTE_SET_TEMPERATURE_LEGACY = 2;
+const uint8_t REMOTE_SET_TEMPERATURE = 3;
+
+const uint8_t FLAG_POWER = 0x01;
+const uint8_t FLAG_MODE = 0x02;
+const uint8_t FLAG_TARGET = 0x04;
+const uint8_t FLAG_FAN = 0x08;
+const uint8_t FLAG_VANE = 0x10;
+const uint8_t FLAG2_HORIZONTAL_VANE = 0x01;
+
+const uint8_t MODE_HEAT = 0x01;
+const uint8_t MODE_DRY = 0x02;
+const uint8_t MODE_COOL = 0x03;
+const uint8_t MODE_FAN = 0x07;
+const uint8_t MODE_AUTO = 0x08;
+
+const uint8_t GET_RESPONSE_SIZE = 16;
+const uint8_t CONNECT_RESPONSE_SIZE = 1;
+
+uint16_t requestKey(uint8_t type, uint8_t command) { return static_cast<uint16_t>(type << 8 | command); }
+
+}  // namespace
+
+HeatpumpSim::HeatpumpSim(ScriptedUART &uart) : uart{uart} {
+  modelMicros = nowMicros();
+  // Each write is a frame, handled once its last byte has reached the unit
+  uart.onWrite([this](const uint8_t *data, size_t length, uint64_t sentMicros) {
+    reader.push(data, length, [this, sentMicros](const RawPacket &request) { handle(request, sentMicros); });
+  });
+}
+
+const HeatpumpSim::State &HeatpumpSim::state() {
+  advanceTo(nowMicros());
+  return current;
+}
+
+HeatpumpSim::State &HeatpumpSim::mutableState() {
+  advanceTo(nowMicros());
+  return current;
+}
+
+uint32_t HeatpumpSim::received(const PacketType type, const uint8_t command) const {
+  auto found = receivedCounts.find(requestKey(static_cast<uint8_t>(type), command));
+  return found == receivedCounts.end() ? 0 : found->second;
+}
+
+void HeatpumpSim::handle(const RawPacket &request, const uint64_t receivedMicros) {
+  advanceTo(receivedMicros);
+
+  switch (static_cast<PacketType>(request.getPacketType())) {
+    case PacketType::connect_request: {
+      RawPacket response(PacketType::connect_response, CONNECT_RESPONSE_SIZE);
+      respond(response, receivedMicros);
+      break;
+    }
+    case PacketType::extended_connect_request: {
+      RawPacket response(PacketType::extended_connect_response, GET_RESPONSE_SIZE);
+      response.setPayloadByte(0, request.getCommand())
+          .setPayloadByte(7, 0x20 | 0x40)  // Vane and vane swing
+          .setPayloadByte(10, MUARTUtils::DegCToTempScaleA(16.0f))
+          .setPayloadByte(11, MUARTUtils::DegCToTempScaleA(31.0f))
+          .setPayloadByte(12, MUARTUtils::DegCToTempScaleA(10.0f))
+          .setPayloadByte(13, MUARTUtils::DegCToTempScaleA(31.0f))
+          .setPayloadByte(14, MUARTUtils::DegCToTempScaleA(16.0f))
+          .setPayloadByte(15, MUARTUtils::DegCToTempScaleA(31.0f));
+      respond(response, receivedMicros);
+      break;
+    }
+    case PacketType::get_request:
+      respond(getResponse(request.getCommand()), receivedMicros);
+      break;
+    case PacketType::set_request: {
+      if (request.getCommand() == static_cast<uint8_t>(SetCommand::thermostat_hello)) break;
+      if (request.getCommand() == static_cast<uint8_t>(SetCommand::settings)) {
+        applySettings(request);
+        settingsSetMicros = receivedMicros;
+      } else if (request.getCommand() == static_cast<uint8_t>(SetCommand::remote_temperature)) {
+        applyRemoteTemperature(request);
+      }
+      RawPacket response(PacketType::set_response, GET_RESPONSE_SIZE);
+      response.setPayloadByte(0, request.getCommand());
+      respond(response, receivedMicros);
+      break;
+    }
+    default:
+      rejectedTotal++;
+      return;
+  }
+
+  receivedCounts[requestKey(request.getPacketType(), request.getCommand())]++;
+  receivedTotal++;
+  if (requestCallback) requestCallback(request, receivedMicros);
+}
+
+void HeatpumpSim::respond(const RawPacket &response, const uint64_t receivedMicros) {
+  RawPacket frame = response;
+  frame.finalize();
+  uart.transmit(frame.getBytes(), frame.getLength(), receivedMicros + processingMicros);
+}
+
+RawPacket HeatpumpSim::getResponse(const uint8_t command) {
+  RawPacket response(PacketType::get_response, GET_RESPONSE_SIZE);
+  response.setPayloadByte(0, command);
+  const uint8_t frequency = static_cast<uint8_t>(std::lround(current.compressorFrequency));
+
+  switch (static_cast<GetCommand>(command)) {
+    case GetCommand::settings:
+      response.setPayloadByte(3, current.power)
+          .setPayloadByte(4, current.mode)
+          .setPayloadByte(5, MUARTUtils::DegCToLegacyTargetTemp(current.targetTemperature))
+          .setPayloadByte(6, current.fan)
+          .setPayloadByte(7, current.vane)
+          .setPayloadByte(10, current.horizontalVane)
+          .setPayloadByte(11, MUARTUtils::DegCToTempScaleA(current.targetTemperature));
+      break;
+    case GetCommand::current_temp:
+      response.setPayloadByte(3, MUARTUtils::DegCToLegacyRoomTemp(controlTemperature()))
+          .setPayloadByte(6, MUARTUtils::DegCToTempScaleA(controlTemperature()));
+      break;
+    case GetCommand::error_info:
+      response.setPayloadByte(4, current.errorCode >> 8).setPayloadByte(5, current.errorCode & 0xff);
+      break;
+    case GetCommand::status:
+      response.setPayloadByte(3, frequency).setPayloadByte(4, frequency > 0);
+      break;
+    case GetCommand::standby: {
+      uint8_t actualFan = 0;
+      if (current.power) actualFan = frequency > 0 ? 3 : 1;
+      response.setPayloadByte(3, current.power && frequency == 0 ? 0x08 : 0x00).setPayloadByte(4, actualFan);
+      break;
+    }
+    default:
+      // Commands the unit knows but the simulation doesn't model get an empty response
+      break;
+  }
+  return response;
+}
+
+// Applies only the settings the request flags as set
+void HeatpumpSim::applySettings(const RawPacket &request) {
+  const uint8_t flags = request.getPayloadByte(SET_FLAGS);
+  const uint8_t flags2 = request.getPayloadByte(SET_FLAGS2);
+
+  if (flags & FLAG_POWER) current.power = request.getPayloadByte(SETTINGS_SET_POWER) != 0;
+  if (flags & FLAG_MODE) current.mode = request.getPayloadByte(SETTINGS_SET_MODE);
+  if (flags & FLAG_TARGET) {
+    const uint8_t target = request.getPayloadByte(SETTINGS_SET_TARGET);
+    current.targetTemperature = target != 0
+                                    ? MUARTUtils::TempScaleAToDegC(target)
+                                    : MUARTUtils::LegacyTargetTempToDegC(request.getPayloadByte(SETTINGS_SET_TARGET_LEGACY));
+  }
+  if (flags & FLAG_FAN) current.fan = request.getPayloadByte(SETTINGS_SET_FAN);
+  if (flags & FLAG_VANE) current.vane = request.getPayloadByte(SETTINGS_SET_VANE);
+  if (flags2 & FLAG2_HORIZONTAL_VANE) current.horizontalVane = request.getPayloadByte(SETTINGS_SET_HORIZONTAL_VANE);
+}
+
+// Flags of 0 hand control back to the unit's own sensor
+void HeatpumpSim::applyRemoteTemperature(const RawPacket &request) {
+  if (request.getPayloadByte(SET_FLAGS) == 0) {
+    current.remoteTemperature = NAN;
+    return;
+  }
+  const uint8_t temperature = request.getPayloadByte(REMOTE_SET_TEMPERATURE);
+  current.remoteTemperature =
+      temperature != 0 ? MUARTUtils::TempScaleAToDegC(temperature)
+                       : MUARTUtils::LegacyRoomTempToDegC(request.getPayloadByte(REMOTE_SET_TEMPERATURE_LEGACY));
+}
+
+float HeatpumpSim::controlTemperature() const {
+  return std::isnan(current.remoteTemperature) ? current.roomTemperature : current.remoteTemperature;
+}
+
+// Steps the compressor and room model forward, a second at a time
+void HeatpumpSim::advanceTo(const uint64_t micros) {
+  while (modelMicros < micros) {
+    const uint64_t stepMicros = std::min<uint64_t>(micros - modelMicros, 1000000);
+    const float seconds = stepMicros / 1e6f;
+    modelMicros += stepMicros;
+
+    // Positive when the room needs heating
+    const float error = current.targetTemperature - controlTemperature();
+    float direction = 0;
+    if (current.power) {
+      switch (current.mode) {
+        case MODE_HEAT:
+          direction = 1;
+          break;
+        case MODE_COOL:
+        case MODE_DRY:
+          direction = -1;
+          break;
+        case MODE_AUTO:
+          direction = error >= 0 ? 1 : -1;
+          break;
+        case MODE_FAN:
+        default:
+          break;
+      }
+    }
+    const float demand = std::max(0.0f, direction * error);
+    const float desired = std::min(maxCompressorFrequency, compressorGain * demand);
+    const float slew = compressorSlewPerSecond * seconds;
+    current.compressorFrequency += std::max(-slew, std::min(slew, desired - current.compressorFrequency));
+
+    const float hours = seconds / 3600.0f;
+    current.roomTemperature += (direction * roomDegreesPerHertzHour * current.compressorFrequency -
+                                roomLossPerHour * (current.roomTemperature - outdoorTemperature)) *
+                               hours;
+  }
+}
+
+}  // namespace host
+}  // namespace esphome
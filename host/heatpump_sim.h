@@ -0,0 +1,97 @@
+#pragma once
+
+#include "frame_reader.h"
+#include "scripted_uart.h"
+#include "muart_rawpacket.h"
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <map>
+
+namespace esphome {
+namespace host {
+
+/* A simulated CN105 indoor unit on the far end of a ScriptedUART.
+
+Every frame the component writes is parsed once its last byte has crossed the wire, and answered after a processing
+delay: connect and extended connect requests, every get request (settings, current temperature, error info, status,
+standby, and anything else with an empty response), settings set requests and remote temperature set requests.  A
+thermostat hello is accepted without a response, as the real unit does.  Replies
+travel back at the UART's baud rate, so a round trip costs two frames of wire time plus the processing delay.
+
+The unit keeps the state a real one reports.  Settings set requests change only the fields they flag.  While running,
+the compressor frequency follows the error between the setpoint and the controlling temperature (the remote
+temperature if one was set, otherwise the room), and the room is heated or cooled in proportion to it, drifting back
+towards the outdoor temperature otherwise.
+
+Responses are encoded with the simulator's own field offsets rather than the component's schemas, so that the two are
+an independent check on each other.
+*/
+class HeatpumpSim {
+ public:
+  using RequestCallback = std::function<void(const mitsubishi_uart::RawPacket &request, uint64_t receivedMicros)>;
+
+  struct State {
+    bool power = false;
+    uint8_t mode = 0x01;  // SettingsSetRequestPacket::MODE_BYTE_*
+    float targetTemperature = 21.0f;
+    uint8_t fan = 0x00;  // SettingsSetRequestPacket::FAN_*
+    uint8_t vane = 0x00;
+    uint8_t horizontalVane = 0x03;
+    float roomTemperature = 18.0f;
+    float remoteTemperature = NAN;  // Set by the controller; NAN when the unit uses its own sensor
+    float compressorFrequency = 0;
+    uint16_t errorCode = 0x8000;  // No error
+  };
+
+  explicit HeatpumpSim(ScriptedUART &uart);
+
+  // Time between a request's last byte arriving and the response's first byte leaving
+  uint32_t processingMicros = 30000;
+  // Compressor and room model
+  float outdoorTemperature = 10.0f;
+  float maxCompressorFrequency = 80.0f;
+  float compressorGain = 40.0f;  // Hz per degree of error
+  float compressorSlewPerSecond = 2.0f;  // Hz per second
+  float roomDegreesPerHertzHour = 0.1f;  // Heating (or cooling) per Hz of compressor, per hour
+  float roomLossPerHour = 0.2f;  // Fraction of the difference to outdoors lost per hour
+
+  // The unit's state, with the model advanced to now
+  const State &state();
+  // Changes the unit's state directly (as the unit's own remote would)
+  State &mutableState();
+
+  // Called with every request the unit accepts
+  void onRequest(RequestCallback callback) { requestCallback = std::move(callback); }
+
+  // Requests received, by packet type and command
+  uint32_t received(mitsubishi_uart::PacketType type, uint8_t command) const;
+  uint32_t totalReceived() const { return receivedTotal; }
+  // Frames that couldn't be parsed, had a bad checksum, or were of a type the unit doesn't accept
+  uint32_t rejected() const { return reader.rejected() + rejectedTotal; }
+  // When the last settings set request finished arriving
+  uint64_t lastSettingsSetMicros() const { return settingsSetMicros; }
+
+ private:
+  void handle(const mitsubishi_uart::RawPacket &request, uint64_t receivedMicros);
+  void respond(const mitsubishi_uart::RawPacket &response, uint64_t receivedMicros);
+  mitsubishi_uart::RawPacket getResponse(uint8_t command);
+  void applySettings(const mitsubishi_uart::RawPacket &request);
+  void applyRemoteTemperature(const mitsubishi_uart::RawPacket &request);
+  void advanceTo(uint64_t micros);
+  float controlTemperature() const;
+
+  ScriptedUART &uart;
+  RequestCallback requestCallback;
+  State current;
+  uint64_t modelMicros = 0;
+
+  FrameReader reader;
+  std::map<uint16_t, uint32_t> receivedCounts;  // By type << 8 | command
+  uint32_t receivedTotal = 0;
+  uint32_t rejectedTotal = 0;
+  uint64_t settingsSetMicros = 0;
+};
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,154 @@
+#include "mhk2_sim.h"
+#include "host.h"
+#include "muart_utils.h"
+
+namespace esphome {
+namespace host {
+
+using namespace mitsubishi_uart;
+
+namespace {
+
+const GetCommand POLLS[] = {GetCommand::settings, GetCommand::current_temp, GetCommand::status, GetCommand::standby,
+                            GetCommand::error_info};
+const uint8_t POLL_COUNT = sizeof(POLLS) / sizeof(POLLS[0]);
+// pollIndex value for the remote temperature set request that ends some cycles
+const uint8_t REMOTE_TEMPERATURE_INDEX = POLL_COUNT;
+
+}  // namespace
+
+Mhk2Sim::Mhk2Sim(ScriptedUART &uart) : uart{uart} {
+  // MUART's writes to the thermostat are the thermostat's responses, acted on once they've arrived
+  uart.onWrite([this](const uint8_t *data, size_t length, uint64_t sentMicros) {
+    reader.push(data, length, [this, sentMicros](const RawPacket &frame) { onResponse(frame, sentMicros); });
+  });
+}
+
+void Mhk2Sim::tick() {
+  const uint64_t now = nowMicros();
+
+  if (awaiting && responded && now >= responseMicros) {
+    awaiting = false;
+    if (exchangeCallback) {
+      exchangeCallback(Exchange{static_cast<PacketType>(request.getPacketType()), request.getCommand(),
+                                requestArrivedMicros, responseMicros, response.getLength()});
+    }
+    switch (phase) {
+      case Phase::connect:
+        phase = Phase::hello;
+        break;
+      case Phase::a9:
+        phase = Phase::polling;
+        break;
+      default:
+        if (pollIndex == POLL_COUNT - 1) {
+          cycles++;
+          pollIndex = remoteTemperatureEveryCycles && cycles % remoteTemperatureEveryCycles == 0
+                          ? REMOTE_TEMPERATURE_INDEX
+                          : 0;
+        } else {
+          pollIndex = pollIndex == REMOTE_TEMPERATURE_INDEX ? 0 : pollIndex + 1;
+        }
+        break;
+    }
+    nextSendMicros = responseMicros + requestGapMicros;
+  } else if (awaiting && now >= requestArrivedMicros + responseTimeoutMicros) {
+    // Start the handshake again, or move on to the next poll
+    awaiting = false;
+    timedOut++;
+    if (phase != Phase::polling) {
+      phase = Phase::connect;
+    } else {
+      pollIndex = pollIndex >= POLL_COUNT - 1 ? 0 : pollIndex + 1;
+    }
+    nextSendMicros = now;
+  }
+
+  if (!awaiting && now >= nextSendMicros) sendNext(now);
+}
+
+void Mhk2Sim::onResponse(const RawPacket &frame, const uint64_t arrivedMicros) {
+  if (!awaiting || responded || !answers(request, frame)) {
+    unexpectedCount++;
+    return;
+  }
+  responded = true;
+  response = frame;
+  responseMicros = arrivedMicros;
+}
+
+void Mhk2Sim::sendNext(const uint64_t startMicros) {
+  switch (phase) {
+    case Phase::connect: {
+      RawPacket connect(PacketType::connect_request, 2);
+      connect.setPayloadByte(0, 0xca).setPayloadByte(1, 0x01);
+      send(connect, startMicros, true);
+      break;
+    }
+    case Phase::hello: {
+      // Model and serial number as the MHK2 packs them, and a firmware version; the unit doesn't reply
+      RawPacket hello(PacketType::set_request, 16);
+      hello.setPayloadByte(0, static_cast<uint8_t>(SetCommand::thermostat_hello))
+          .setPayloadByte(1, 0x48)
+          .setPayloadByte(2, 0xb2)
+          .setPayloadByte(3, 0xce)
+          .setPayloadByte(13, 2)
+          .setPayloadByte(14, 1)
+          .setPayloadByte(15, 0);
+      send(hello, startMicros, false);
+      phase = Phase::a9;
+      nextSendMicros = requestArrivedMicros + requestGapMicros;
+      break;
+    }
+    case Phase::a9: {
+      RawPacket a9(PacketType::get_request, 10);
+      a9.setPayloadByte(0, static_cast<uint8_t>(GetCommand::a_9));
+      send(a9, startMicros, true);
+      break;
+    }
+    case Phase::polling:
+      if (pollIndex == REMOTE_TEMPERATURE_INDEX) {
+        RawPacket remote(PacketType::set_request, 4);
+        remote.setPayloadByte(0, static_cast<uint8_t>(SetCommand::remote_temperature))
+            .setPayloadByte(1, 0x01)
+            .setPayloadByte(2, MUARTUtils::DegCToLegacyRoomTemp(roomTemperature))
+            .setPayloadByte(3, MUARTUtils::DegCToTempScaleA(roomTemperature));
+        send(remote, startMicros, true);
+      } else {
+        RawPacket get(PacketType::get_request, 16);
+        get.setPayloadByte(0, static_cast<uint8_t>(POLLS[pollIndex]));
+        send(get, startMicros, true);
+      }
+      break;
+  }
+}
+
+void Mhk2Sim::send(const RawPacket &frame, const uint64_t startMicros, const bool expectResponse) {
+  request = frame;
+  request.finalize();
+  uart.transmit(request.getBytes(), request.getLength(), startMicros);
+  requestArrivedMicros = uart.receiveLineFreeMicros();
+  sent++;
+  awaiting = expectResponse;
+  responded = false;
+}
+
+// Set responses aren't checked for their command, since MUART's own answers to remote temperatures don't carry one
+bool Mhk2Sim::answers(const RawPacket &request, const RawPacket &response) {
+  switch (static_cast<PacketType>(request.getPacketType())) {
+    case PacketType::connect_request:
+      return response.getPacketType() == static_cast<uint8_t>(PacketType::connect_response);
+    case PacketType::extended_connect_request:
+      return response.getPacketType() == static_cast<uint8_t>(PacketType::extended_connect_response);
+    case PacketType::get_request:
+      return response.getPacketType() == static_cast<uint8_t>(PacketType::get_response) &&
+             response.getCommand() == request.getCommand();
+    case PacketType::set_request:
+      return response.getPacketType() == static_cast<uint8_t>(PacketType::set_response);
+    default:
+      return false;
+  }
+}
+
+}  // namespace host
+}  // namespace esphome
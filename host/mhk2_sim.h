@@ -0,0 +1,91 @@
+#pragma once
+
+#include "frame_reader.h"
+#include "scripted_uart.h"
+#include "muart_rawpacket.h"
+#include <cstdint>
+#include <functional>
+
+namespace esphome {
+namespace host {
+
+/* A simulated MHK2 thermostat on the thermostat side of a ScriptedUART, talking to MUART's thermostat bridge as if
+it were the heatpump.
+
+It runs the MHK2's handshake (connect, thermostat hello, A9 get) and then polls settings, current temperature, status,
+standby and error info in turn, sending its room temperature with a remote temperature set request every few cycles.
+Like the real thermostat it has one request outstanding at a time: the next is sent a short gap after the response
+arrives (or after the request has been sent, for the hello, which has no response), or after a timeout.
+
+Requests are sent with 2400-baud wire timing.  Every completed exchange is reported with when the request finished
+arriving at MUART and when the response finished arriving back, which is what the passthrough benchmark measures.
+*/
+class Mhk2Sim {
+ public:
+  struct Exchange {
+    mitsubishi_uart::PacketType type;
+    uint8_t command;
+    uint64_t requestArrivedMicros;  // When the request's last byte reached MUART
+    uint64_t responseMicros;  // When the response's last byte reached the thermostat
+    uint8_t responseLength;
+  };
+  using ExchangeCallback = std::function<void(const Exchange &exchange)>;
+
+  explicit Mhk2Sim(ScriptedUART &uart);
+
+  // Time from a response arriving to the next request starting
+  uint32_t requestGapMicros = 250000;
+  uint32_t responseTimeoutMicros = 5000000;
+  // A remote temperature set request is sent after every this many poll cycles
+  uint8_t remoteTemperatureEveryCycles = 4;
+  float roomTemperature = 21.5f;
+
+  // Sends the next request once it's due, and completes an exchange whose response has arrived.  Call once per
+  // main loop iteration.
+  void tick();
+
+  void onExchange(ExchangeCallback callback) { exchangeCallback = std::move(callback); }
+
+  // True once the handshake has completed
+  bool connected() const { return phase == Phase::polling; }
+  uint32_t requestsSent() const { return sent; }
+  // The most recent request sent
+  const mitsubishi_uart::RawPacket &lastRequest() const { return request; }
+  uint32_t timeouts() const { return timedOut; }
+  // Responses that weren't to the outstanding request, and frames that couldn't be parsed
+  uint32_t unexpected() const { return unexpectedCount + reader.rejected(); }
+  uint32_t pollCycles() const { return cycles; }
+
+ private:
+  enum class Phase { connect, hello, a9, polling };
+
+  void onResponse(const mitsubishi_uart::RawPacket &response, uint64_t arrivedMicros);
+  void sendNext(uint64_t startMicros);
+  void send(const mitsubishi_uart::RawPacket &request, uint64_t startMicros, bool expectResponse);
+  static bool answers(const mitsubishi_uart::RawPacket &request, const mitsubishi_uart::RawPacket &response);
+
+  ScriptedUART &uart;
+  FrameReader reader;
+  ExchangeCallback exchangeCallback;
+
+  Phase phase = Phase::connect;
+  uint8_t pollIndex = 0;
+  uint32_t cycles = 0;
+
+  // The outstanding request, if any
+  bool awaiting = false;
+  mitsubishi_uart::RawPacket request;
+  uint64_t requestArrivedMicros = 0;
+  // Its response, once written by MUART (it's only acted on when it has arrived)
+  bool responded = false;
+  mitsubishi_uart::RawPacket response;
+  uint64_t responseMicros = 0;
+
+  uint64_t nextSendMicros = 0;
+  uint32_t sent = 0;
+  uint32_t timedOut = 0;
+  uint32_t unexpectedCount = 0;
+};
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#include "muart_harness.h"
+
+namespace esphome {
+namespace host {
+
+using namespace mitsubishi_uart;
+
+MuartHarness::MuartHarness(const bool withThermostat) : muart(&heatpumpUart) {
+  muart.set_name("Heatpump");
+  muart.set_update_interval(5000);
+
+  if (withThermostat) muart.set_thermostat_uart(&thermostatUart);
+
+  climate::ClimateTraits &traits = muart.config_traits();
+  traits.set_supported_modes({climate::CLIMATE_MODE_OFF, climate::CLIMATE_MODE_HEAT, climate::CLIMATE_MODE_DRY,
+                              climate::CLIMATE_MODE_COOL, climate::CLIMATE_MODE_FAN_ONLY,
+                              climate::CLIMATE_MODE_HEAT_COOL});
+  traits.set_supported_fan_modes({climate::CLIMATE_FAN_AUTO, climate::CLIMATE_FAN_QUIET, climate::CLIMATE_FAN_LOW,
+                                  climate::CLIMATE_FAN_MEDIUM, climate::CLIMATE_FAN_HIGH});
+  traits.set_supported_custom_fan_modes({FAN_MODE_VERYHIGH});
+
+  const std::pair<sensor::Sensor *, const char *> namedSensors[] = {
+      {&thermostatTemperature, "Thermostat Temperature"}, {&compressorFrequency, "Compressor Frequency"},
+      {&roundTripP50, "Round Trip p50"},                 {&roundTripP95, "Round Trip p95"},
+      {&roundTripMax, "Round Trip Max"},                 {&roundTripSettingsMax, "Round Trip Settings Max"}};
+  for (const auto &named : namedSensors) named.first->set_name(named.second);
+  actualFan.set_name("Actual Fan Speed");
+  serviceFilter.set_name("Service Filter");
+  defrost.set_name("Defrost");
+  hotAdjust.set_name("Preheat");
+  standby.set_name("Standby");
+  errorCode.set_name("Error Code");
+
+  muart.set_thermostat_temperature_sensor(&thermostatTemperature);
+  muart.set_compressor_frequency_sensor(&compressorFrequency);
+  muart.set_actual_fan_sensor(&actualFan);
+  muart.set_service_filter_sensor(&serviceFilter);
+  muart.set_defrost_sensor(&defrost);
+  muart.set_hot_adjust_sensor(&hotAdjust);
+  muart.set_standby_sensor(&standby);
+  muart.set_error_code_sensor(&errorCode);
+  muart.set_round_trip_p50_sensor(&roundTripP50);
+  muart.set_round_trip_p95_sensor(&roundTripP95);
+  muart.set_round_trip_max_sensor(&roundTripMax);
+  muart.set_round_trip_sensor(RoundTripCommand::get_settings, RoundTripStatistic::max, &roundTripSettingsMax);
+
+  temperatureSource.set_name("Temperature Source");
+  std::vector<std::string> sources = {TEMPERATURE_SOURCE_INTERNAL};
+  if (withThermostat) sources.push_back(TEMPERATURE_SOURCE_THERMOSTAT);
+  temperatureSource.traits.set_options(sources);
+  vanePosition.set_name("Vane Position");
+  vanePosition.traits.set_options({"Auto", "1", "2", "3", "4", "5", "Swing"});
+  horizontalVanePosition.set_name("Horizontal Vane Position");
+  horizontalVanePosition.traits.set_options({"Auto", "<<", "<", "|", ">", ">>", "<>", "Swing"});
+
+  muart.set_temperature_source_select(&temperatureSource);
+  temperatureSource.set_parent(&muart);
+  muart.set_vane_position_select(&vanePosition);
+  vanePosition.set_parent(&muart);
+  muart.set_horizontal_vane_position_select(&horizontalVanePosition);
+  horizontalVanePosition.set_parent(&muart);
+}
+
+void MuartHarness::setup() { muart.call_setup(); }
+
+void MuartHarness::loopOnce() {
+  for (auto &ticker : tickers) ticker();
+  muart.loop();
+  runScheduler();
+}
+
+void MuartHarness::runUntil(const uint64_t untilMicros) {
+  while (nowMicros() < untilMicros) {
+    loopOnce();
+    setMicros(std::min<uint64_t>(nowMicros() + loopMicros, untilMicros));
+  }
+}
+
+}  // namespace host
+}  // namespace esphome
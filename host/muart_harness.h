@@ -0,0 +1,61 @@
+#pragma once
+
+#include "host.h"
+#include "scripted_uart.h"
+#include "mitsubishi_uart.h"
+#include "muart_select.h"
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+/* MitsubishiUART wired up the way the code generated by __init__.py does it, with every sensor and select configured,
+on scripted UARTs.  The clock is virtual: run() calls loop() once per loop interval (as ESPHome's main loop does when
+idle), runs whatever is scheduled, and jumps the clock to the next iteration.
+*/
+class MuartHarness {
+ public:
+  explicit MuartHarness(bool withThermostat);
+
+  // Calls setup() and starts update() on its interval
+  void setup();
+
+  // One iteration of the main loop: tickers, loop(), then any timeouts or intervals that are due
+  void loopOnce();
+  // Iterates the main loop until the clock reaches `untilMicros`
+  void runUntil(uint64_t untilMicros);
+  void runFor(uint64_t durationMicros) { runUntil(nowMicros() + durationMicros); }
+
+  // Called at the start of every loop iteration (e.g. to let a simulator act)
+  void addTicker(std::function<void()> ticker) { tickers.push_back(std::move(ticker)); }
+
+  uint32_t loopMicros = 16000;
+
+  ScriptedUART heatpumpUart;
+  ScriptedUART thermostatUart;
+  mitsubishi_uart::MitsubishiUART muart;
+
+  sensor::Sensor thermostatTemperature;
+  sensor::Sensor compressorFrequency;
+  text_sensor::TextSensor actualFan;
+  binary_sensor::BinarySensor serviceFilter;
+  binary_sensor::BinarySensor defrost;
+  binary_sensor::BinarySensor hotAdjust;
+  binary_sensor::BinarySensor standby;
+  text_sensor::TextSensor errorCode;
+  sensor::Sensor roundTripP50;
+  sensor::Sensor roundTripP95;
+  sensor::Sensor roundTripMax;
+  sensor::Sensor roundTripSettingsMax;
+
+  mitsubishi_uart::TemperatureSourceSelect temperatureSource;
+  mitsubishi_uart::VanePositionSelect vanePosition;
+  mitsubishi_uart::HorizontalVanePositionSelect horizontalVanePosition;
+
+ private:
+  std::vector<std::function<void()>> tickers;
+};
+
+}  // namespace host
+}  // namespace esphome
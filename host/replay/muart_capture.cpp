@@ -0,0 +1,65 @@
+#include "heatpump_sim.h"
+#include "mhk2_sim.h"
+#include "muart_harness.h"
+#include <cstring>
+
+/* Records a capture for muart_replay from the simulators, the way one is taken from a device: the log of a session
+with dump_flight_recorder called often enough that consecutive dumps overlap.
+
+  muart_capture heatpump|thermostat <capture.log>
+
+"heatpump" is MUART alone with the simulated unit, connecting, polling and then changing the setpoint and mode.
+"thermostat" adds a simulated MHK2 whose traffic MUART passes through.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+using namespace esphome::mitsubishi_uart;
+
+namespace {
+
+const uint64_t SECOND_MICROS = 1000000;
+
+// Dumps often enough that the recorder's 32 frames always reach back to the previous dump
+void runWithDumps(MuartHarness &harness, uint64_t untilMicros, uint64_t dumpIntervalMicros) {
+  while (nowMicros() < untilMicros) {
+    harness.runFor(std::min(dumpIntervalMicros, untilMicros - nowMicros()));
+    harness.muart.dump_flight_recorder();
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3 || (strcmp(argv[1], "heatpump") != 0 && strcmp(argv[1], "thermostat") != 0)) {
+    fprintf(stderr, "usage: %s heatpump|thermostat <capture.log>\n", argv[0]);
+    return 2;
+  }
+  const bool withThermostat = strcmp(argv[1], "thermostat") == 0;
+  FILE *out = fopen(argv[2], "w");
+  if (!out) {
+    fprintf(stderr, "can't write %s\n", argv[2]);
+    return 2;
+  }
+  setLogOutput(out);
+  setLogLevel(ESPHOME_LOG_LEVEL_CONFIG);
+
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(withThermostat);
+  HeatpumpSim heatpump(harness.heatpumpUart);
+  heatpump.mutableState().power = true;
+  Mhk2Sim thermostat(harness.thermostatUart);
+  if (withThermostat) harness.addTicker([&thermostat]() { thermostat.tick(); });
+  harness.setup();
+
+  // MUART's own polls come to a few frames every 5 s update; the thermostat adds several a second
+  const uint64_t dumpInterval = (withThermostat ? 3 : 20) * SECOND_MICROS;
+  runWithDumps(harness, 45 * SECOND_MICROS, dumpInterval);
+  harness.muart.make_call().set_mode(climate::CLIMATE_MODE_COOL).set_target_temperature(17.5f).perform();
+  harness.vanePosition.make_call().set_option("Swing").perform();
+  runWithDumps(harness, 100 * SECOND_MICROS, dumpInterval);
+
+  fclose(out);
+  return 0;
+}
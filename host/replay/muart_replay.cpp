@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "trace_replay.h"
+#include <fstream>
+
+/* Replays a flight recorder capture through MitsubishiUART and checks the outcome against golden output.
+
+  muart_replay [--active|--passive] [--update] [--count N] <capture.log> <expected.golden>
+
+The capture is any log holding dump_flight_recorder output (see TraceReader).  The outcome (TraceReplay::run) must
+match the golden file line for line; --update writes it instead.  The component is active if the original was (it
+sent polls of its own), unless --active or --passive says otherwise.  --count replays the trace N times to measure
+throughput, which is printed as frames replayed per second of CPU time.
+*/
+
+using namespace esphome;
+using namespace esphome::host;
+
+namespace {
+
+bool readLines(const std::string &path, std::vector<std::string> &lines) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string text;
+  while (std::getline(in, text)) lines.push_back(text);
+  return true;
+}
+
+bool writeLines(const std::string &path, const std::vector<std::string> &lines) {
+  std::ofstream out(path);
+  for (const std::string &text : lines) out << text << '\n';
+  return static_cast<bool>(out);
+}
+
+// Prints the first few differing lines, returning true if there were none
+bool compare(const std::vector<std::string> &expected, const std::vector<std::string> &actual) {
+  const size_t MAX_REPORTED = 10;
+  size_t reported = 0;
+  for (size_t i = 0; i < std::max(expected.size(), actual.size()) && reported < MAX_REPORTED; i++) {
+    const std::string *want = i < expected.size() ? &expected[i] : nullptr;
+    const std::string *got = i < actual.size() ? &actual[i] : nullptr;
+    if (want && got && *want == *got) continue;
+    printf("line %zu:\n  expected: %s\n  actual:   %s\n", i + 1, want ? want->c_str() : "(none)",
+           got ? got->c_str() : "(none)");
+    reported++;
+  }
+  return reported == 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool update = false;
+  int mode = -1;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--update") {
+      update = true;
+    } else if (arg == "--active" || arg == "--passive") {
+      mode = arg == "--active";
+    } else if (arg == "--count") {
+      i++;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    fprintf(stderr, "usage: %s [--active|--passive] [--update] [--count N] <capture.log> <expected.golden>\n", argv[0]);
+    return 2;
+  }
+  const uint64_t count = benchCount(argc, argv, 1);
+  quietLogs();
+
+  TraceReader reader;
+  std::string error;
+  if (!reader.readFile(paths[0], error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 2;
+  }
+  if (reader.gaps() > 0) {
+    printf("%s: %u dumps didn't overlap the one before, so frames may be missing\n", paths[0].c_str(), reader.gaps());
+  }
+  TraceReplay replay(reader.records());
+  if (mode >= 0) replay.active = mode == 1;
+
+  BenchCase bench(paths[0].c_str());
+  bench.start();
+  std::vector<std::string> outcome = replay.run();
+  for (uint64_t i = 1; i < count; i++) {
+    if (replay.run() != outcome) {
+      printf("%s: replay %llu differs from the first; the replay isn't deterministic\n", paths[0].c_str(),
+             static_cast<unsigned long long>(i + 1));
+      return 1;
+    }
+  }
+  bench.stop(replay.framesReplayed() * count);
+  char extra[160];
+  snprintf(extra, sizeof(extra), "%zu frames in the trace, heatpump requests unanswered %zu, responses unplayed %zu",
+           reader.records().size(), replay.unanswered(), replay.unplayed());
+  bench.print("frame", extra);
+
+  if (update) {
+    if (!writeLines(paths[1], outcome)) {
+      fprintf(stderr, "can't write %s\n", paths[1].c_str());
+      return 2;
+    }
+    printf("wrote %s\n", paths[1].c_str());
+    return 0;
+  }
+
+  std::vector<std::string> expected;
+  if (!readLines(paths[1], expected)) {
+    fprintf(stderr, "can't read %s (run with --update to create it)\n", paths[1].c_str());
+    return 2;
+  }
+  return compare(expected, outcome) ? 0 : 1;
+}
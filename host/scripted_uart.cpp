@@ -0,0 +1,79 @@
+#include "scripted_uart.h"
+#include "host.h"
+#include <algorithm>
+#include <climits>
+
+namespace esphome {
+namespace host {
+
+void ScriptedUART::transmit(const uint8_t *data, const size_t length, const uint64_t startMicros) {
+  uint64_t arrival = std::max(startMicros, rxLineFree);
+  for (size_t i = 0; i < length; i++) {
+    arrival += byteMicros();
+    rx.push_back(TimedByte{arrival, data[i]});
+  }
+  rxLineFree = arrival;
+}
+
+void ScriptedUART::inject(const uint8_t *data, const size_t length) {
+  const uint64_t now = nowMicros();
+  for (size_t i = 0; i < length; i++) rx.push_back(TimedByte{now, data[i]});
+}
+
+void ScriptedUART::repeat(const uint8_t *data, const size_t length, const uint64_t totalBytes) {
+  repeatData = data;
+  repeatLength = length;
+  repeatIndex = 0;
+  repeatRemaining = length > 0 ? totalBytes : 0;
+}
+
+uint64_t ScriptedUART::nextArrivalMicros() const {
+  // Bytes arrive in order, so only the first can be the next to arrive
+  return rx.empty() ? UINT64_MAX : rx.front().arrivalMicros;
+}
+
+void ScriptedUART::write_array(const uint8_t *data, const size_t len) {
+  if (captureWrites) writtenBytes.insert(writtenBytes.end(), data, data + len);
+  writtenTotal += len;
+
+  txLineFree = std::max(txLineFree, nowMicros()) + static_cast<uint64_t>(byteMicros()) * len;
+  if (writeCallback) writeCallback(data, len, txLineFree);
+}
+
+bool ScriptedUART::peek_byte(uint8_t *data) {
+  if (repeatRemaining > 0) {
+    *data = repeatData[repeatIndex];
+    return true;
+  }
+  if (available() == 0) return false;
+  *data = rx.front().value;
+  return true;
+}
+
+bool ScriptedUART::read_array(uint8_t *data, const size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (repeatRemaining > 0) {
+      data[i] = repeatData[repeatIndex];
+      repeatIndex = (repeatIndex + 1) % repeatLength;
+      repeatRemaining--;
+    } else if (!rx.empty() && rx.front().arrivalMicros <= nowMicros()) {
+      data[i] = rx.front().value;
+      rx.pop_front();
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ScriptedUART::available() {
+  if (repeatRemaining > 0) return static_cast<int>(std::min<uint64_t>(repeatRemaining, INT_MAX));
+
+  const uint64_t now = nowMicros();
+  size_t count = 0;
+  while (count < rx.size() && rx[count].arrivalMicros <= now) count++;
+  return static_cast<int>(count);
+}
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esphome/components/uart/uart.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+// CN105 runs at 2400 baud, 8E1: a start bit, 8 data bits, a parity bit and a stop bit for every byte
+static const uint32_t CN105_BAUD_RATE = 2400;
+static const uint8_t CN105_BITS_PER_BYTE = 11;
+
+/* An in-memory UART whose receive side is scripted by the test, and whose transmit side is captured.
+
+Bytes given to transmit() arrive one at a time at the configured baud rate, each becoming readable once its last bit
+would have been received, so the component sees them trickle in as it would on the wire.  inject() makes bytes
+readable straight away, and repeat() replays a buffer as an endless receive stream (for benchmarks, without any
+per-byte bookkeeping).
+
+Writes are timed the same way: the write callback is given the time the last byte would have left the wire.
+*/
+class ScriptedUART : public uart::UARTComponent {
+ public:
+  using WriteCallback = std::function<void(const uint8_t *data, size_t length, uint64_t sentMicros)>;
+
+  ScriptedUART() { set_baud_rate(CN105_BAUD_RATE); }
+
+  // Time taken for a byte to cross the wire
+  uint32_t byteMicros() const { return (1000000ULL * bitsPerByte + get_baud_rate() - 1) / get_baud_rate(); }
+  void setBitsPerByte(uint8_t bits) { bitsPerByte = bits; }
+
+  // Sends bytes to the component, starting at `startMicros` or once the bytes already on the wire have arrived
+  void transmit(const uint8_t *data, size_t length, uint64_t startMicros);
+  void transmit(const std::vector<uint8_t> &data, uint64_t startMicros) { transmit(data.data(), data.size(), startMicros); }
+  // Makes bytes readable immediately, behind any already waiting
+  void inject(const uint8_t *data, size_t length);
+  // Replays `data` as the receive stream until `totalBytes` have been read (the buffer must outlive the replay)
+  void repeat(const uint8_t *data, size_t length, uint64_t totalBytes);
+
+  // When the next byte still on the wire becomes readable, or UINT64_MAX if there aren't any
+  uint64_t nextArrivalMicros() const;
+  // Bytes not yet read by the component, including those still on the wire
+  size_t pending() const { return rx.size() + static_cast<size_t>(repeatRemaining); }
+  // When the receive line is next free (the last scripted byte has arrived)
+  uint64_t receiveLineFreeMicros() const { return rxLineFree; }
+
+  // Called with every write made by the component
+  void onWrite(WriteCallback callback) { writeCallback = std::move(callback); }
+  // Every byte written by the component (unless capture is disabled)
+  const std::vector<uint8_t> &written() const { return writtenBytes; }
+  void clearWritten() { writtenBytes.clear(); }
+  void setCaptureWrites(bool capture) { captureWrites = capture; }
+  uint64_t writtenCount() const { return writtenTotal; }
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override {}
+
+ private:
+  struct TimedByte {
+    uint64_t arrivalMicros;
+    uint8_t value;
+  };
+
+  uint8_t bitsPerByte = CN105_BITS_PER_BYTE;
+
+  std::deque<TimedByte> rx;
+  uint64_t rxLineFree = 0;
+  const uint8_t *repeatData = nullptr;
+  size_t repeatLength = 0;
+  size_t repeatIndex = 0;
+  uint64_t repeatRemaining = 0;
+
+  WriteCallback writeCallback;
+  std::vector<uint8_t> writtenBytes;
+  bool captureWrites = true;
+  uint64_t writtenTotal = 0;
+  uint64_t txLineFree = 0;
+};
+
+}  // namespace host
+}  // namespace esphome
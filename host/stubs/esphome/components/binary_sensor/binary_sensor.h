@@ -0,0 +1,20 @@
+#pragma once
+
+#include "esphome/core/entity_base.h"
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor : public EntityBase {
+ public:
+  void publish_state(bool state) {
+    this->state = state;
+    publish_count_++;
+  }
+  bool has_state() const { return publish_count_ > 0; }
+
+  bool state{false};
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "esphome/core/entity_base.h"
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace select {
+
+class Select;
+
+class SelectTraits {
+ public:
+  void set_options(std::vector<std::string> options) { options_ = std::move(options); }
+  const std::vector<std::string> &get_options() const { return options_; }
+
+ protected:
+  std::vector<std::string> options_;
+};
+
+class SelectCall {
+ public:
+  explicit SelectCall(Select *parent) : parent_{parent} {}
+
+  SelectCall &set_option(const std::string &option) {
+    option_ = option;
+    return *this;
+  }
+  void perform();
+
+ protected:
+  Select *parent_;
+  optional<std::string> option_;
+};
+
+class Select : public EntityBase {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    publish_count_++;
+  }
+
+  SelectCall make_call() { return SelectCall(this); }
+
+  size_t size() const { return traits.get_options().size(); }
+  bool has_option(const std::string &option) const { return index_of(option).has_value(); }
+  bool has_index(size_t index) const { return index < size(); }
+  optional<size_t> index_of(const std::string &option) const {
+    for (size_t i = 0; i < size(); i++) {
+      if (traits.get_options()[i] == option) return i;
+    }
+    return nullopt;
+  }
+  optional<std::string> at(size_t index) const {
+    if (!has_index(index)) return nullopt;
+    return traits.get_options()[index];
+  }
+
+  std::string state;
+  SelectTraits traits;
+
+ protected:
+  friend class SelectCall;
+
+  virtual void control(const std::string &value) = 0;
+};
+
+inline void SelectCall::perform() {
+  if (option_.has_value() && parent_->has_option(option_.value())) parent_->control(option_.value());
+}
+
+}  // namespace select
+}  // namespace esphome
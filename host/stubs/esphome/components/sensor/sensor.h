@@ -0,0 +1,31 @@
+#pragma once
+
+#include "esphome/core/entity_base.h"
+#include <cmath>
+#include <functional>
+#include <vector>
+
+namespace esphome {
+namespace sensor {
+
+// No filters on the host, so state and raw_state are always the same
+class Sensor : public EntityBase {
+ public:
+  void publish_state(float state) {
+    raw_state = state;
+    this->state = state;
+    publish_count_++;
+    for (auto &callback : callbacks_) callback(state);
+  }
+  void add_on_state_callback(std::function<void(float)> &&callback) { callbacks_.push_back(std::move(callback)); }
+  bool has_state() const { return publish_count_ > 0; }
+
+  float state{NAN};
+  float raw_state{NAN};
+
+ protected:
+  std::vector<std::function<void(float)>> callbacks_;
+};
+
+}  // namespace sensor
+}  // namespace esphome
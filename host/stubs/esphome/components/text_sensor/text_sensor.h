@@ -0,0 +1,23 @@
+#pragma once
+
+#include "esphome/core/entity_base.h"
+#include <string>
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor : public EntityBase {
+ public:
+  void publish_state(const std::string &state) {
+    raw_state = state;
+    this->state = state;
+    publish_count_++;
+  }
+  bool has_state() const { return publish_count_ > 0; }
+
+  std::string state;
+  std::string raw_state;
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
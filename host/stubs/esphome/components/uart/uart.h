@@ -0,0 +1,34 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace uart {
+
+// Same shape as ESPHome's UARTComponent: the byte-level calls are virtual, the rest are built on them
+class UARTComponent {
+ public:
+  virtual ~UARTComponent() = default;
+
+  virtual void write_array(const uint8_t *data, size_t len) = 0;
+  virtual bool peek_byte(uint8_t *data) = 0;
+  virtual bool read_array(uint8_t *data, size_t len) = 0;
+  // Number of bytes available for reading
+  virtual int available() = 0;
+  // Waits until all bytes have been sent
+  virtual void flush() = 0;
+
+  void write_byte(uint8_t data) { write_array(&data, 1); }
+  bool read_byte(uint8_t *data) { return read_array(data, 1); }
+
+  void set_baud_rate(uint32_t baud_rate) { baud_rate_ = baud_rate; }
+  uint32_t get_baud_rate() const { return baud_rate_; }
+
+ protected:
+  uint32_t baud_rate_ = 2400;
+};
+
+}  // namespace uart
+}  // namespace esphome
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include <string>
+
+namespace esphome {
+
+class Application {
+ public:
+  std::string get_compilation_time() const { return __DATE__ ", " __TIME__; }
+};
+
+extern Application App;
+
+}  // namespace esphome
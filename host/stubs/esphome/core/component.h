@@ -0,0 +1,54 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/optional.h"
+#include <functional>
+#include <string>
+
+namespace esphome {
+
+namespace setup_priority {
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float AFTER_CONNECTION = 100.0f;
+}  // namespace setup_priority
+
+/* Timeouts and intervals run from host::runScheduler(), against the host clock, in the order they fall due.  A name
+identifies a timeout or interval within its component, as on the device.
+*/
+class Component {
+ public:
+  virtual ~Component();
+
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return setup_priority::DATA; }
+
+ protected:
+  void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+  bool cancel_interval(const std::string &name);
+  void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+  bool cancel_timeout(const std::string &name);
+};
+
+class PollingComponent : public Component {
+ public:
+  PollingComponent() : PollingComponent(0) {}
+  explicit PollingComponent(uint32_t update_interval) : update_interval_{update_interval} {}
+
+  // Starts calling update() every update interval, as ESPHome does once setup() has run
+  void call_setup();
+
+  virtual void update() = 0;
+
+  void set_update_interval(uint32_t update_interval) { update_interval_ = update_interval; }
+  uint32_t get_update_interval() const { return update_interval_; }
+
+ protected:
+  uint32_t update_interval_;
+};
+
+}  // namespace esphome
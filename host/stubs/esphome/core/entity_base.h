@@ -0,0 +1,22 @@
+#pragma once
+
+#include "esphome/core/helpers.h"
+#include <string>
+
+namespace esphome {
+
+class EntityBase {
+ public:
+  const std::string &get_name() const { return name_; }
+  void set_name(const std::string &name) { name_ = name; }
+  uint32_t get_object_id_hash() const { return fnv1_hash(name_); }
+
+  // Host only: how many times the entity has published its state
+  uint32_t host_publish_count() const { return publish_count_; }
+
+ protected:
+  std::string name_;
+  uint32_t publish_count_ = 0;
+};
+
+}  // namespace esphome
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+// Backed by the host clock (see host::setMicros), which is virtual unless host::useRealClock() is called
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+}  // namespace esphome
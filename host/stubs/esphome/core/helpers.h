@@ -0,0 +1,35 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/core/optional.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+using std::to_string;
+
+uint32_t fnv1_hash(const std::string &str);
+
+std::string format_hex(const uint8_t *data, size_t length);
+std::string format_hex_pretty(const uint8_t *data, size_t length);
+
+std::string base64_encode(const uint8_t *buf, size_t buf_len);
+std::vector<uint8_t> base64_decode(const std::string &encoded_string);
+
+template<typename T> class Parented {
+ public:
+  Parented() {}
+  Parented(T *parent) : parent_(parent) {}
+
+  T *get_parent() const { return parent_; }
+  void set_parent(T *parent) { parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+}  // namespace esphome
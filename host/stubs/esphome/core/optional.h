@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utility>
+
+namespace esphome {
+
+/* Mirrors ESPHome's own optional<>, which (unlike std::optional) default-constructs its value and doesn't check
+has_value() in value().  The component relies on both, so the host build must too.
+*/
+struct nullopt_t {
+  explicit constexpr nullopt_t(int) {}
+};
+constexpr nullopt_t nullopt{0};
+
+template<typename T> class optional {
+ public:
+  optional() {}
+  optional(nullopt_t) {}
+  optional(const T &value) : has_value_{true}, value_{value} {}
+  optional(T &&value) : has_value_{true}, value_{std::move(value)} {}
+
+  optional &operator=(nullopt_t) {
+    reset();
+    return *this;
+  }
+  template<typename U> optional &operator=(U &&value) {
+    has_value_ = true;
+    value_ = std::forward<U>(value);
+    return *this;
+  }
+
+  void reset() {
+    has_value_ = false;
+    value_ = T{};
+  }
+
+  bool has_value() const { return has_value_; }
+  explicit operator bool() const { return has_value_; }
+
+  T &value() { return value_; }
+  const T &value() const { return value_; }
+  T &operator*() { return value_; }
+  const T &operator*() const { return value_; }
+  T *operator->() { return &value_; }
+  const T *operator->() const { return &value_; }
+
+  template<typename U> T value_or(U &&fallback) const { return has_value_ ? value_ : T(std::forward<U>(fallback)); }
+
+ private:
+  bool has_value_ = false;
+  T value_{};
+};
+
+template<typename T> bool operator==(const optional<T> &a, nullopt_t) { return !a.has_value(); }
+template<typename T> bool operator!=(const optional<T> &a, nullopt_t) { return a.has_value(); }
+template<typename T, typename U> bool operator==(const optional<T> &a, const U &b) { return a.has_value() && *a == b; }
+template<typename T, typename U> bool operator!=(const optional<T> &a, const U &b) { return !(a == b); }
+
+}  // namespace esphome
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace esphome {
+
+// Preferences are kept in memory by hash, and survive for as long as the process does
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  explicit ESPPreferenceObject(std::vector<uint8_t> *storage) : storage_{storage} {}
+
+  template<typename T> bool save(const T *src) {
+    if (storage_ == nullptr) return false;
+    storage_->assign(reinterpret_cast<const uint8_t *>(src), reinterpret_cast<const uint8_t *>(src) + sizeof(T));
+    saves_++;
+    return true;
+  }
+
+  template<typename T> bool load(T *dest) {
+    if (storage_ == nullptr || storage_->size() != sizeof(T)) return false;
+    memcpy(static_cast<void *>(dest), storage_->data(), sizeof(T));
+    return true;
+  }
+
+  // Host only: number of times save() has been called on preferences (across all objects)
+  static uint32_t host_save_count() { return saves_; }
+
+ private:
+  std::vector<uint8_t> *storage_ = nullptr;
+  static uint32_t saves_;
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) {
+    return ESPPreferenceObject(storage(type));
+  }
+
+ private:
+  std::vector<uint8_t> *storage(uint32_t type);
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,270 @@
+#include "host.h"
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include <chrono>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+Application App;
+
+////
+// Clock
+////
+
+static uint64_t virtualMicros = 0;
+static bool realClock = false;
+static std::chrono::steady_clock::time_point realClockStart;
+static uint64_t realClockOffset = 0;
+
+void host::setMicros(const uint64_t now) {
+  virtualMicros = now;
+  if (realClock) useRealClock(true);
+}
+
+void host::advanceMicros(const uint64_t delta) { setMicros(nowMicros() + delta); }
+
+uint64_t host::nowMicros() {
+  if (!realClock) return virtualMicros;
+  const auto elapsed = std::chrono::steady_clock::now() - realClockStart;
+  return realClockOffset + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void host::useRealClock(const bool real) {
+  if (realClock && !real) virtualMicros = nowMicros();
+  realClock = real;
+  realClockStart = std::chrono::steady_clock::now();
+  realClockOffset = virtualMicros;
+}
+
+uint32_t millis() { return static_cast<uint32_t>(host::nowMicros() / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(host::nowMicros()); }
+void delay(const uint32_t ms) { host::advanceMicros(static_cast<uint64_t>(ms) * 1000); }
+void delayMicroseconds(const uint32_t us) { host::advanceMicros(us); }
+
+////
+// Scheduler
+////
+
+namespace {
+
+struct ScheduledItem {
+  Component *component;
+  std::string name;
+  bool interval;
+  uint32_t periodMillis;
+  uint64_t dueMicros;
+  std::function<void()> callback;
+  bool removed;
+};
+
+std::vector<ScheduledItem> &scheduled() {
+  static std::vector<ScheduledItem> items;
+  return items;
+}
+
+bool cancelItem(Component *component, const std::string &name, const bool interval) {
+  bool found = false;
+  for (ScheduledItem &item : scheduled()) {
+    if (!item.removed && item.component == component && item.interval == interval && item.name == name) {
+      item.removed = true;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void addItem(Component *component, const std::string &name, const bool interval, const uint32_t periodMillis,
+             std::function<void()> &&callback) {
+  cancelItem(component, name, interval);
+  scheduled().push_back(ScheduledItem{component, name, interval, periodMillis,
+                                      host::nowMicros() + static_cast<uint64_t>(periodMillis) * 1000,
+                                      std::move(callback), false});
+}
+
+}  // namespace
+
+void host::runScheduler() {
+  // Callbacks may schedule more items, so work by index, and only run what was due when we started
+  const uint64_t now = nowMicros();
+  for (;;) {
+    std::vector<ScheduledItem> &items = scheduled();
+    size_t next = items.size();
+    for (size_t i = 0; i < items.size(); i++) {
+      if (items[i].removed || items[i].dueMicros > now) continue;
+      if (next == items.size() || items[i].dueMicros < items[next].dueMicros) next = i;
+    }
+    if (next == items.size()) break;
+
+    std::function<void()> callback = items[next].callback;
+    if (items[next].interval) {
+      // Intervals keep their phase, but never run more than once per call
+      const uint64_t period = std::max<uint64_t>(items[next].periodMillis, 1) * 1000;
+      while (items[next].dueMicros <= now) items[next].dueMicros += period;
+    } else {
+      items[next].removed = true;
+    }
+    callback();
+  }
+
+  std::vector<ScheduledItem> &items = scheduled();
+  items.erase(std::remove_if(items.begin(), items.end(), [](const ScheduledItem &item) { return item.removed; }),
+              items.end());
+}
+
+uint64_t host::nextDueMicros() {
+  uint64_t due = UINT64_MAX;
+  for (const ScheduledItem &item : scheduled()) {
+    if (!item.removed && item.dueMicros < due) due = item.dueMicros;
+  }
+  return due;
+}
+
+void host::resetScheduler() { scheduled().clear(); }
+
+Component::~Component() {
+  for (ScheduledItem &item : scheduled()) {
+    if (item.component == this) item.removed = true;
+  }
+}
+
+void Component::set_interval(const std::string &name, const uint32_t interval, std::function<void()> &&f) {
+  addItem(this, name, true, interval, std::move(f));
+}
+bool Component::cancel_interval(const std::string &name) { return cancelItem(this, name, true); }
+void Component::set_timeout(const std::string &name, const uint32_t timeout, std::function<void()> &&f) {
+  addItem(this, name, false, timeout, std::move(f));
+}
+bool Component::cancel_timeout(const std::string &name) { return cancelItem(this, name, false); }
+
+void PollingComponent::call_setup() {
+  setup();
+  set_interval("update", get_update_interval(), [this]() { update(); });
+}
+
+////
+// Logging
+////
+
+static int currentLogLevel() {
+  static const int fromEnvironment = [] {
+    const char *level = getenv("MUART_HOST_LOG_LEVEL");
+    return level ? atoi(level) : ESPHOME_LOG_LEVEL_WARN;
+  }();
+  return fromEnvironment;
+}
+
+static int configuredLogLevel = -1;
+static FILE *logOutput = nullptr;
+static uint32_t warnings = 0;
+
+void host::setLogLevel(const int level) { configuredLogLevel = level; }
+int host::logLevel() { return configuredLogLevel >= 0 ? configuredLogLevel : currentLogLevel(); }
+void host::setLogOutput(FILE *out) { logOutput = out; }
+uint32_t host::warningCount() { return warnings; }
+
+void esp_log_printf_(const int level, const char *tag, const int line, const char *format, ...) {
+  if (level <= ESPHOME_LOG_LEVEL_WARN) warnings++;
+  if (level > host::logLevel()) return;
+
+  static const char LEVEL_LETTERS[] = "-EWICDVV";
+  FILE *out = logOutput ? logOutput : stderr;
+  fprintf(out, "[%c][%s:%d]: ", LEVEL_LETTERS[level], tag, line);
+  va_list args;
+  va_start(args, format);
+  vfprintf(out, format, args);
+  va_end(args);
+  fputc('\n', out);
+}
+
+////
+// Helpers
+////
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= static_cast<uint8_t>(c);
+  }
+  return hash;
+}
+
+std::string format_hex(const uint8_t *data, const size_t length) {
+  static const char DIGITS[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    out += DIGITS[data[i] >> 4];
+    out += DIGITS[data[i] & 0x0f];
+  }
+  return out;
+}
+
+std::string format_hex_pretty(const uint8_t *data, const size_t length) {
+  static const char DIGITS[] = "0123456789ABCDEF";
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    if (i > 0) out += '.';
+    out += DIGITS[data[i] >> 4];
+    out += DIGITS[data[i] & 0x0f];
+  }
+  if (length > 4) out += " (" + to_string(length) + ")";
+  return out;
+}
+
+static const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64_encode(const uint8_t *buf, const size_t buf_len) {
+  std::string out;
+  for (size_t i = 0; i < buf_len; i += 3) {
+    uint32_t group = static_cast<uint32_t>(buf[i]) << 16;
+    if (i + 1 < buf_len) group |= static_cast<uint32_t>(buf[i + 1]) << 8;
+    if (i + 2 < buf_len) group |= buf[i + 2];
+    out += BASE64_CHARS[(group >> 18) & 0x3f];
+    out += BASE64_CHARS[(group >> 12) & 0x3f];
+    out += i + 1 < buf_len ? BASE64_CHARS[(group >> 6) & 0x3f] : '=';
+    out += i + 2 < buf_len ? BASE64_CHARS[group & 0x3f] : '=';
+  }
+  return out;
+}
+
+std::vector<uint8_t> base64_decode(const std::string &encoded_string) {
+  std::vector<uint8_t> out;
+  uint32_t group = 0;
+  int bits = 0;
+  for (char c : encoded_string) {
+    const char *found = c != '\0' ? strchr(BASE64_CHARS, c) : nullptr;
+    if (found == nullptr) break;  // Padding, or the end of the encoded data
+    group = (group << 6) | static_cast<uint32_t>(found - BASE64_CHARS);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back((group >> bits) & 0xff);
+    }
+  }
+  return out;
+}
+
+////
+// Preferences
+////
+
+uint32_t ESPPreferenceObject::saves_ = 0;
+
+std::vector<uint8_t> *ESPPreferences::storage(const uint32_t type) {
+  static std::map<uint32_t, std::vector<uint8_t>> stored;
+  return &stored[type];
+}
+
+static ESPPreferences hostPreferences;
+ESPPreferences *global_preferences = &hostPreferences;
+
+}  // namespace esphome
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+/* Controls for the host build's stand-ins for the ESPHome runtime: the clock, the scheduler behind
+set_timeout/set_interval, and logging.
+*/
+namespace esphome {
+namespace host {
+
+// The clock is virtual (it only moves when told to) so that runs are repeatable; micros() and millis() wrap as they
+// do on the device.
+void setMicros(uint64_t now);
+void advanceMicros(uint64_t delta);
+uint64_t nowMicros();
+// Follow the wall clock instead (from the current virtual time), e.g. to measure the component's own overheads
+void useRealClock(bool real);
+
+// Runs every timeout and interval that's due at the current time
+void runScheduler();
+// When the next timeout or interval falls due, or UINT64_MAX if none are pending
+uint64_t nextDueMicros();
+// Drops every pending timeout and interval
+void resetScheduler();
+
+// Log statements at or below this level are printed (ESPHOME_LOG_LEVEL_*).  Defaults to MUART_HOST_LOG_LEVEL from the
+// environment, or ESPHOME_LOG_LEVEL_WARN.
+void setLogLevel(int level);
+int logLevel();
+void setLogOutput(FILE *out);
+// Number of log statements at ESPHOME_LOG_LEVEL_WARN or more severe, printed or not
+uint32_t warningCount();
+
+}  // namespace host
+}  // namespace esphome
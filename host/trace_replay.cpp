@@ -0,0 +1,289 @@
+#include "trace_replay.h"
+#include "frame_reader.h"
+#include "muart_harness.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+
+namespace esphome {
+namespace host {
+
+using namespace mitsubishi_uart;
+
+namespace {
+
+const uint8_t FLAG_SENT = 0x80;
+// Time for the component to settle once the trace has ended
+const uint64_t REPLAY_SETTLE_MICROS = 2000000;
+
+std::string hex(const uint8_t *bytes, size_t length) {
+  static const char DIGITS[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < length; i++) {
+    if (i > 0) out += ' ';
+    out += DIGITS[bytes[i] >> 4];
+    out += DIGITS[bytes[i] & 0x0f];
+  }
+  return out;
+}
+
+std::string line(const char *format, ...) __attribute__((format(printf, 1, 2)));
+std::string line(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  return buffer;
+}
+
+bool isBase64(char c) { return isalnum(static_cast<unsigned char>(c)) || c == '+' || c == '/' || c == '='; }
+
+}  // namespace
+
+////
+// TraceRecord
+////
+
+bool TraceRecord::sent() const { return meta & FLAG_SENT; }
+
+SourceBridge TraceRecord::link() const { return static_cast<SourceBridge>((meta >> 4) & 0x03); }
+
+ControllerAssociation TraceRecord::association() const {
+  return static_cast<ControllerAssociation>((meta >> 2) & 0x03);
+}
+
+bool TraceRecord::sameFrame(const TraceRecord &other) const {
+  return recordedMicros == other.recordedMicros && meta == other.meta && length == other.length &&
+         memcmp(bytes, other.bytes, length) == 0;
+}
+
+////
+// TraceReader
+////
+
+bool TraceReader::readFile(const std::string &path, std::string &error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = "can't open " + path;
+    return false;
+  }
+  std::string text;
+  size_t lineNumber = 0;
+  while (std::getline(in, text)) {
+    lineNumber++;
+    if (!readLine(text)) {
+      error = path + ":" + std::to_string(lineNumber) + ": malformed flight recorder line";
+      return false;
+    }
+  }
+  if (records().empty()) {
+    error = path + ": no flight recorder frames";
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::readLine(const std::string &text) {
+  // "FRnn <base64>", with the index as two or more digits
+  size_t at = text.find("FR");
+  while (at != std::string::npos) {
+    size_t digits = at + 2;
+    while (digits < text.size() && isdigit(static_cast<unsigned char>(text[digits]))) digits++;
+    if (digits - at >= 4 && digits < text.size() && text[digits] == ' ') break;
+    at = text.find("FR", at + 2);
+  }
+  if (at == std::string::npos) return true;
+
+  const unsigned index = std::stoul(text.substr(at + 2));
+  const size_t start = text.find(' ', at) + 1;
+  size_t end = start;
+  while (end < text.size() && isBase64(text[end])) end++;
+  const std::vector<uint8_t> decoded = base64_decode(text.substr(start, end - start));
+
+  if (decoded.size() < 6 || decoded[5] > PACKET_MAX_SIZE || decoded.size() != 6u + decoded[5]) return false;
+  TraceRecord record{};
+  for (size_t b = 0; b < sizeof(uint32_t); b++) record.recordedMicros |= static_cast<uint32_t>(decoded[b]) << (8 * b);
+  record.meta = decoded[4];
+  record.length = decoded[5];
+  memcpy(record.bytes, &decoded[6], record.length);
+
+  if (index == 0) mergeDump();
+  dump.push_back(record);
+  return true;
+}
+
+const std::vector<TraceRecord> &TraceReader::records() {
+  mergeDump();
+  return trace;
+}
+
+// Appends the frames of the current dump that follow on from the trace, unwrapping their timestamps
+void TraceReader::mergeDump() {
+  if (dump.empty()) return;
+
+  // The longest run at the end of the trace that the dump starts with
+  size_t overlap = std::min(trace.size(), dump.size());
+  for (; overlap > 0; overlap--) {
+    bool matches = true;
+    for (size_t i = 0; i < overlap && matches; i++) matches = trace[trace.size() - overlap + i].sameFrame(dump[i]);
+    if (matches) break;
+  }
+  if (overlap == 0 && !trace.empty()) gapCount++;
+
+  for (size_t i = overlap; i < dump.size(); i++) {
+    TraceRecord record = dump[i];
+    record.micros = trace.empty() ? 0 : trace.back().micros + static_cast<uint32_t>(record.recordedMicros - trace.back().recordedMicros);
+    trace.push_back(record);
+  }
+  dump.clear();
+}
+
+////
+// TraceReplay
+////
+
+TraceReplay::TraceReplay(const std::vector<TraceRecord> &records) : records{records} {
+  active = std::any_of(records.begin(), records.end(), [](const TraceRecord &record) {
+    return record.sent() && record.link() == SourceBridge::heatpump &&
+           record.association() == ControllerAssociation::muart;
+  });
+}
+
+std::vector<std::string> TraceReplay::run() {
+  const bool withThermostat = std::any_of(records.begin(), records.end(), [](const TraceRecord &record) {
+    return record.link() == SourceBridge::thermostat;
+  });
+
+  // The clock runs from boot as the original's did, so the component's timers line up with the recording
+  const uint64_t start = records.empty() ? 0 : records.front().recordedMicros;
+  setMicros(0);
+  resetScheduler();
+  MuartHarness harness(withThermostat);
+  harness.muart.set_active_mode(active);
+
+  // Heatpump responses, keyed by the request (as bytes) that the original sent before each, in trace order
+  struct Response {
+    const TraceRecord *record;
+    uint64_t delayMicros;  // From the request being written to the response's last byte arriving
+  };
+  std::map<std::string, std::deque<Response>> responses;
+  std::vector<const TraceRecord *> unprompted;
+  const TraceRecord *request = nullptr;
+  for (const TraceRecord &record : records) {
+    if (record.link() != SourceBridge::heatpump) {
+      if (!record.sent()) unprompted.push_back(&record);
+      continue;
+    }
+    if (record.sent()) {
+      request = &record;
+      continue;
+    }
+    if (request && (active || request->association() == ControllerAssociation::thermostat)) {
+      responses[std::string(reinterpret_cast<const char *>(request->bytes), request->length)].push_back(
+          {&record, record.micros - request->micros});
+    } else {
+      unprompted.push_back(&record);
+    }
+    request = nullptr;
+  }
+
+  std::vector<std::string> routed;
+  FrameReader heatpumpFrames;
+  FrameReader thermostatFrames;
+  size_t answered = 0;
+  unansweredCount = 0;
+  harness.heatpumpUart.setCaptureWrites(false);
+  harness.heatpumpUart.onWrite([&](const uint8_t *data, size_t length, uint64_t) {
+    heatpumpFrames.push(data, length, [&](const RawPacket &frame) {
+      routed.push_back("routed heatpump " + hex(frame.getBytes(), frame.getLength()));
+      auto found = responses.find(std::string(reinterpret_cast<const char *>(frame.getBytes()), frame.getLength()));
+      if (found == responses.end() || found->second.empty()) {
+        unansweredCount++;
+        return;
+      }
+      const Response response = found->second.front();
+      found->second.pop_front();
+      const uint64_t arrival = nowMicros() + response.delayMicros;
+      const uint64_t wire = static_cast<uint64_t>(harness.heatpumpUart.byteMicros()) * response.record->length;
+      harness.heatpumpUart.transmit(response.record->bytes, response.record->length,
+                                    std::max(nowMicros(), arrival > wire ? arrival - wire : 0));
+      answered++;
+    });
+  });
+  harness.thermostatUart.setCaptureWrites(false);
+  harness.thermostatUart.onWrite([&](const uint8_t *data, size_t length, uint64_t) {
+    thermostatFrames.push(data, length, [&routed](const RawPacket &frame) {
+      routed.push_back("routed thermostat " + hex(frame.getBytes(), frame.getLength()));
+    });
+  });
+
+  harness.setup();
+
+  // The rest arrive when they were recorded, their last byte at the recorded time
+  for (const TraceRecord *record : unprompted) {
+    ScriptedUART &uart = record->link() == SourceBridge::thermostat ? harness.thermostatUart : harness.heatpumpUart;
+    const uint64_t arrival = start + record->micros;
+    const uint64_t wire = static_cast<uint64_t>(uart.byteMicros()) * record->length;
+    uart.transmit(record->bytes, record->length, arrival > wire ? arrival - wire : 0);
+  }
+
+  const uint64_t end = start + (records.empty() ? 0 : records.back().micros) + REPLAY_SETTLE_MICROS;
+  while (nowMicros() < end) {
+    const uint64_t writtenBefore = harness.heatpumpUart.writtenCount() + harness.thermostatUart.writtenCount();
+    // Timers run after the component's loop, so what they queue is sent on the next one
+    const bool timerDue = nextDueMicros() <= nowMicros();
+    harness.loopOnce();
+    const bool busy = timerDue || harness.heatpumpUart.available() > 0 || harness.thermostatUart.available() > 0 ||
+                      harness.heatpumpUart.writtenCount() + harness.thermostatUart.writtenCount() != writtenBefore;
+
+    // Idle until the next frame or timer, unless there's still work in hand
+    uint64_t next = std::min({harness.heatpumpUart.nextArrivalMicros(), harness.thermostatUart.nextArrivalMicros(),
+                              nextDueMicros(), end});
+    if (busy) next = std::min(next, nowMicros() + harness.loopMicros);
+    setMicros(std::max(next, nowMicros() + 1));
+  }
+
+  replayed = unprompted.size() + answered;
+  unplayedCount = 0;
+  for (const auto &pending : responses) unplayedCount += pending.second.size();
+
+  std::vector<std::string> lines;
+  const MitsubishiUART &muart = harness.muart;
+  std::string fan = "-";
+  if (muart.custom_fan_mode.has_value()) {
+    fan = muart.custom_fan_mode.value();
+  } else if (muart.fan_mode.has_value()) {
+    fan = std::to_string(muart.fan_mode.value());
+  }
+  lines.push_back(line("climate mode=%d action=%d current=%.2f target=%.2f fan=%s", static_cast<int>(muart.mode),
+                       static_cast<int>(muart.action), muart.current_temperature, muart.target_temperature,
+                       fan.c_str()));
+  for (const sensor::Sensor *sensor : {&harness.thermostatTemperature, &harness.compressorFrequency,
+                                       &harness.roundTripP50, &harness.roundTripP95, &harness.roundTripMax,
+                                       &harness.roundTripSettingsMax}) {
+    lines.push_back(line("sensor %s raw_state=%.2f", sensor->get_name().c_str(), sensor->raw_state));
+  }
+  for (const text_sensor::TextSensor *sensor : {&harness.actualFan, &harness.errorCode}) {
+    lines.push_back(line("text_sensor %s raw_state=\"%s\"", sensor->get_name().c_str(), sensor->raw_state.c_str()));
+  }
+  for (const binary_sensor::BinarySensor *sensor :
+       {&harness.serviceFilter, &harness.defrost, &harness.hotAdjust, &harness.standby}) {
+    lines.push_back(line("binary_sensor %s state=%s", sensor->get_name().c_str(),
+                         sensor->has_state() ? ONOFF(sensor->state) : "-"));
+  }
+  for (const select::Select *select :
+       {static_cast<const select::Select *>(&harness.temperatureSource),
+        static_cast<const select::Select *>(&harness.vanePosition),
+        static_cast<const select::Select *>(&harness.horizontalVanePosition)}) {
+    lines.push_back(line("select %s state=\"%s\"", select->get_name().c_str(), select->state.c_str()));
+  }
+  lines.insert(lines.end(), routed.begin(), routed.end());
+  return lines;
+}
+
+}  // namespace host
+}  // namespace esphome
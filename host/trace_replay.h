@@ -0,0 +1,93 @@
+#pragma once
+
+#include "muart_rawpacket.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace host {
+
+// One frame from a flight recorder dump (see FlightRecorder::dump)
+struct TraceRecord {
+  uint64_t micros;  // Unwrapped, from the first record of the trace
+  uint32_t recordedMicros;  // As recorded (micros() on the device, which wraps)
+  uint8_t meta;
+  uint8_t length;
+  uint8_t bytes[mitsubishi_uart::PACKET_MAX_SIZE];
+
+  bool sent() const;
+  // The bridge the frame was sent or received on
+  mitsubishi_uart::SourceBridge link() const;
+  // For sent frames, whose request it was (a forwarded thermostat request, or one of the component's own)
+  mitsubishi_uart::ControllerAssociation association() const;
+  bool sameFrame(const TraceRecord &other) const;
+};
+
+/* Reads flight recorder dumps into a single trace.  The FRnn lines can be anywhere in a log (after ESPHome's log
+prefixes, before colour codes), and a capture can hold several dumps: each one starts at FR00, and where it overlaps
+the frames already read (the recorder keeps its last 32 frames, so consecutive dumps usually repeat some), only the new
+frames are added.
+*/
+class TraceReader {
+ public:
+  // Reads every FRnn line of a log file.  Returns false (with `error` set) if the file can't be read or has none.
+  bool readFile(const std::string &path, std::string &error);
+  // Reads one log line, ignoring it if it isn't a flight recorder line.  Returns false if it is one but is malformed.
+  bool readLine(const std::string &line);
+
+  // The trace so far
+  const std::vector<TraceRecord> &records();
+  // Dumps that didn't overlap the frames before them, so frames may be missing between the two
+  uint32_t gaps() const { return gapCount; }
+
+ private:
+  void mergeDump();
+
+  std::vector<TraceRecord> trace;
+  std::vector<TraceRecord> dump;
+  uint32_t gapCount = 0;
+};
+
+/* Replays a trace through MitsubishiUART at full speed, in virtual time.
+
+Frames the trace received from the thermostat are fed to its scripted UART so that their last byte arrives when they
+were recorded.  The heatpump's responses are paired with the request the original sent before each one, and are
+played back when the replay sends the same request, after the delay the unit took in the trace, so the replay's
+exchanges keep their order even when it forwards a request later than the original did.  Responses to the original's
+own polls answer the replay's polls like the rest when it's active, as it is if the original was, and are played back
+at their recorded time when it's passive.  Frames the trace sent are left out otherwise, since they're what
+the component produces.  The clock runs from the device's boot, as recorded, and jumps straight to the next frame
+whenever the component is idle.
+
+Requests the original made for reasons that aren't on the wire (a climate call from Home Assistant, say) aren't
+repeated, so their responses go unplayed; unplayed() and unanswered() show how far the replay strayed from the
+recording.
+
+run() returns the outcome as text lines, to compare against golden output: the climate state, every sensor's
+raw_state, the selects, then every frame the component routed to each link, in order.
+*/
+class TraceReplay {
+ public:
+  explicit TraceReplay(const std::vector<TraceRecord> &records);
+
+  // Whether the component polls the heatpump itself; by default, whether the original did
+  bool active;
+
+  std::vector<std::string> run();
+  // Received frames fed to the component by the last run
+  size_t framesReplayed() const { return replayed; }
+  // Requests the last run sent the heatpump that the trace had no response left for
+  size_t unanswered() const { return unansweredCount; }
+  // Recorded heatpump responses the last run never sent the request for
+  size_t unplayed() const { return unplayedCount; }
+
+ private:
+  const std::vector<TraceRecord> &records;
+  size_t replayed = 0;
+  size_t unansweredCount = 0;
+  size_t unplayedCount = 0;
+};
+
+}  // namespace host
+}  // namespace esphome